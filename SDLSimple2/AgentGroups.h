@@ -0,0 +1,104 @@
+#pragma once
+#include <vector>
+#include "Entity.h"
+
+// Which entities an AI system drives, kept grouped by what drives them (a
+// behaviour tree, a utility profile) so each group can be run as one batch
+// over contiguous slots. The system keeps whatever else it stores per agent in
+// its own arrays, indexed by slot: add() and remove() report every agent they
+// shift through move(from, to) so those arrays can follow.
+//
+// Groups stay contiguous as agents come and go. Making room in or closing a
+// gap in one group shifts a single agent across each later group's boundary,
+// so neither ever re-sorts the whole set. Each entity carries its own slot,
+// so finding the one to remove doesn't search either.
+class AgentGroups
+{
+private:
+    std::vector<Entity*> m_entities;
+    std::vector<int>     m_groups;
+    std::vector<int>     m_starts = { 0 }; // Group g owns slots [starts[g], starts[g + 1])
+
+    template <typename Move>
+    void relocate(int from, int to, Move &move)
+    {
+        if (from == to) return;
+
+        m_entities[to] = m_entities[from];
+        m_groups[to]   = m_groups[from];
+        m_entities[to]->set_agent_slot(to);
+        move(from, to);
+    }
+
+public:
+    // ————— METHODS ————— //
+    // The new agent's slot. The system's own arrays must already be one longer;
+    // the slot is left for it to fill in.
+    template <typename Move>
+    int add(int group, Entity* entity, Move move)
+    {
+        if (group + 2 > (int) m_starts.size()) m_starts.resize(group + 2, m_starts.back());
+
+        m_entities.push_back(nullptr);
+        m_groups.push_back(group);
+
+        // The first agent of each later group moves to just past its group's end
+        int slot = m_starts.back()++;
+        for (int later = (int) m_starts.size() - 2; later > group; later--)
+        {
+            relocate(m_starts[later], slot, move);
+            slot = m_starts[later]++;
+        }
+
+        m_entities[slot] = entity;
+        m_groups[slot]   = group;
+        entity->set_agent_slot(slot);
+        return slot;
+    }
+
+    // False if the entity isn't an agent. Otherwise the system's last slot is
+    // free afterwards, for it to drop from its own arrays.
+    template <typename Move>
+    bool remove(Entity* entity, Move move)
+    {
+        // The slot may be another system's, so check it is really this one's
+        int slot = entity->get_agent_slot();
+        if (slot < 0 || slot >= get_count() || m_entities[slot] != entity) return false;
+
+        int group = m_groups[slot];
+        entity->set_agent_slot(-1);
+
+        // The gap goes to the group's end, then each later group's last agent fills the one before it
+        int gap = m_starts[group + 1] - 1;
+        relocate(gap, slot, move);
+        for (int later = group + 1; later + 1 < (int) m_starts.size(); later++)
+        {
+            int last = m_starts[later + 1] - 1;
+            relocate(last, gap, move);
+            m_starts[later]--;
+            gap = last;
+        }
+        m_starts.back()--;
+
+        m_entities.pop_back();
+        m_groups.pop_back();
+        return true;
+    }
+
+    void clear()
+    {
+        for (Entity* entity : m_entities) entity->set_agent_slot(-1);
+        m_entities.clear();
+        m_groups.clear();
+        m_starts.assign(1, 0);
+    }
+
+    // ————— GETTERS ————— //
+    int     const get_count()  const { return (int) m_entities.size(); }
+    Entity* const get_entity(int slot) const { return m_entities[slot]; }
+    std::vector<Entity*> const &get_entities() const { return m_entities; }
+
+    // Groups no agent has joined yet are empty
+    int const get_group_start(int group) const { return group < (int) m_starts.size() ? m_starts[group] : get_count(); }
+    int const get_group_end(int group)   const { return get_group_start(group + 1); }
+};
@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include "AnimationSystem.h"
+#include "AssetPack.h"
+#include "Entity.h"
+#include "Profiler.h"
+
+namespace
+{
+    const char* const LOOP_NAMES[] = { "loop", "once", "ping_pong" };
+
+    int find_loop(const std::string &name)
+    {
+        for (int i = 0; i < (int) (sizeof(LOOP_NAMES) / sizeof(LOOP_NAMES[0])); i++)
+        {
+            if (name == LOOP_NAMES[i]) return i;
+        }
+        return -1;
+    }
+}
+
+AnimationState const animation_state_of(glm::vec3 movement)
+{
+    return (AnimationState) ((movement.x < 0.0f) * ANIMATION_LEFT + (movement.x > 0.0f) * ANIMATION_RIGHT);
+}
+
+AnimationSystem::AnimationSystem()
+{
+    clear();
+    add_animator(0);
+}
+
+// Back to just the still clip and set, which the still animator and any
+// animator of a set that went away fall back on
+void AnimationSystem::clear()
+{
+    m_clips.assign(1, AnimationClip());
+    m_clips[0].loops = true;
+    m_timeline.assign(1, -1);
+    m_clip_indices.clear();
+
+    m_set_clips.assign(ANIMATION_STATE_COUNT, 0);
+    m_set_indices.clear();
+
+    for (int &set : m_animator_sets) set = 0;
+}
+
+bool AnimationSystem::load(const char* filepath)
+{
+    std::stringstream infile;
+    if (!read_text_asset(m_asset_pack, filepath, &infile))
+    {
+        std::cout << "No animation clips at " << filepath << std::endl;
+        return false;
+    }
+
+    clear();
+    if (parse(infile, filepath)) return true;
+
+    clear();
+    return false;
+}
+
+// Frames belong to the clip above them, and sets name clips defined before them:
+//
+//   clip walk_left loop 4 4
+//       frames 0.25 1 5 9 13
+//   clip stand once 4 4
+//       frames 0.25 0
+//   set george stand walk_left walk_right
+//
+// A clip's frames are atlas frame indices into its region cut into columns by
+// rows, left to right and top to bottom. Each frames line shows its indices
+// for that many seconds each, so durations can change within a clip.
+bool AnimationSystem::parse(std::istream &infile, const char* filepath)
+{
+    TextAssetReader reader(infile, filepath);
+
+    // The clip being read, until the next keyword lays it out on the timeline
+    struct Frame { int index; int ticks; };
+    std::vector<Frame> frames;
+    AnimationLoop loop = ANIMATION_LOOP;
+
+    auto finish_clip = [&]()
+    {
+        if (m_clips.size() == 1 || m_clips.back().tick_count > 0) return true;
+        if (frames.empty()) return false;
+
+        // A ping pong is laid out there and back, without repeating either end
+        if (loop == ANIMATION_PING_PONG)
+        {
+            for (int i = (int) frames.size() - 2; i > 0; i--) frames.push_back(frames[i]);
+        }
+
+        AnimationClip &clip = m_clips.back();
+        clip.first_tick = (int) m_timeline.size();
+        for (const Frame &frame : frames) m_timeline.insert(m_timeline.end(), frame.ticks, frame.index);
+        clip.tick_count = (int) m_timeline.size() - clip.first_tick;
+
+        frames.clear();
+        return true;
+    };
+
+    while (reader.next_line())
+    {
+        std::istringstream fields(reader.get_line());
+        std::string keyword;
+        fields >> keyword;
+
+        if (keyword == "clip")
+        {
+            if (!finish_clip()) return reader.fail("previous clip has no frames");
+
+            std::string name, loop_name;
+            AnimationClip clip;
+            if (!(fields >> name >> loop_name >> clip.cols >> clip.rows)) return reader.fail("clip needs a name, a loop mode, columns and rows");
+            if (m_clip_indices.count(name)) return reader.fail("clip " + name + " is defined twice");
+            if (clip.cols < 1 || clip.rows < 1) return reader.fail("columns and rows must be at least 1");
+
+            int found = find_loop(loop_name);
+            if (found < 0) return reader.fail("unknown loop mode " + loop_name);
+
+            loop = (AnimationLoop) found;
+            clip.loops      = loop != ANIMATION_ONCE;
+            clip.tick_count = 0;
+
+            m_clip_indices[name] = (int) m_clips.size();
+            m_clips.push_back(clip);
+        }
+        else if (keyword == "frames")
+        {
+            if (m_clips.size() == 1 || m_clips.back().tick_count > 0) return reader.fail("frames outside of a clip");
+
+            float seconds;
+            if (!(fields >> seconds) || seconds <= 0.0f) return reader.fail("frames needs a duration of more than 0 seconds");
+            int ticks = std::max(1, (int) std::lround(seconds * ANIMATION_TICKS_PER_SECOND));
+
+            const AnimationClip &clip = m_clips.back();
+            int index, count = 0;
+            while (fields >> index)
+            {
+                if (index < 0 || index >= clip.cols * clip.rows) return reader.fail("frame " + std::to_string(index) + " is outside the clip's grid");
+                frames.push_back({ index, ticks });
+                count++;
+            }
+            if (!fields.eof()) return reader.fail("frame indices must be whole numbers");
+            if (count == 0)    return reader.fail("frames needs at least one index");
+        }
+        else if (keyword == "set")
+        {
+            if (!finish_clip()) return reader.fail("previous clip has no frames");
+
+            std::string name;
+            if (!(fields >> name)) return reader.fail("set needs a name");
+            if (m_set_indices.count(name)) return reader.fail("set " + name + " is defined twice");
+
+            int clips[ANIMATION_STATE_COUNT];
+            for (int state = 0; state < ANIMATION_STATE_COUNT; state++)
+            {
+                std::string clip;
+                if (!(fields >> clip)) return reader.fail("set needs an idle, a left and a right clip");
+
+                auto found = m_clip_indices.find(clip);
+                if (found == m_clip_indices.end()) return reader.fail("unknown clip " + clip);
+                clips[state] = found->second;
+            }
+
+            m_set_indices[name] = (int) (m_set_clips.size() / ANIMATION_STATE_COUNT);
+            m_set_clips.insert(m_set_clips.end(), clips, clips + ANIMATION_STATE_COUNT);
+        }
+        else
+        {
+            return reader.fail("unknown keyword " + keyword);
+        }
+    }
+
+    if (!finish_clip()) return reader.fail("last clip has no frames");
+    return true;
+}
+
+int AnimationSystem::find_set(const std::string &name) const
+{
+    auto found = m_set_indices.find(name);
+    return found == m_set_indices.end() ? -1 : found->second;
+}
+
+// Starts out still until the next advance() picks its set's idle clip
+int AnimationSystem::add_animator(int set)
+{
+    int animator = (int) m_animator_sets.size();
+    if (!m_free_animators.empty())
+    {
+        animator = m_free_animators.back();
+        m_free_animators.pop_back();
+    }
+    else
+    {
+        m_animator_sets.push_back(0);
+        m_states.push_back(ANIMATION_IDLE);
+        m_playing.push_back(0);
+        m_times.push_back(0.0f);
+        m_frames.push_back(-1);
+    }
+
+    m_animator_sets[animator] = set;
+    m_states[animator]        = ANIMATION_IDLE;
+    m_playing[animator]       = 0;
+    m_times[animator]         = 0.0f;
+    m_frames[animator]        = -1;
+    return animator;
+}
+
+// Freed animators stay in the arrays on the still set, so advance() never has to skip any
+void AnimationSystem::remove_animator(int animator)
+{
+    if (animator <= 0 || animator >= (int) m_animator_sets.size()) return;
+
+    m_animator_sets[animator] = 0;
+    m_playing[animator]       = 0;
+    m_frames[animator]        = -1;
+    m_free_animators.push_back(animator);
+}
+
+// Every animator the same way: its state picks a clip, switching clips starts
+// the new one from the top, and looping or holding is a select on the clip's
+// flag rather than a branch
+void AnimationSystem::advance(float delta_time)
+{
+    PROFILE_ZONE("animation");
+
+    const float ticks_per_second = (float) ANIMATION_TICKS_PER_SECOND;
+    int count = (int) m_animator_sets.size();
+
+    for (int animator = 0; animator < count; animator++)
+    {
+        int clip = m_set_clips[m_animator_sets[animator] * ANIMATION_STATE_COUNT + m_states[animator]];
+        const AnimationClip &playing = m_clips[clip];
+
+        float time     = (clip == m_playing[animator] ? m_times[animator] : 0.0f) + delta_time;
+        float duration = playing.tick_count / ticks_per_second;
+        float wrapped  = time - std::floor(time / duration) * duration;
+        float held     = std::min(time, duration);
+        time = playing.loops ? wrapped : held;
+
+        int tick = std::min((int) (time * ticks_per_second), playing.tick_count - 1);
+        m_frames[animator]  = m_timeline[playing.first_tick + tick];
+        m_playing[animator] = clip;
+        m_times[animator]   = time;
+    }
+}
+
+void AnimationSystem::write_frames(SpriteInstance* sprites, int count) const
+{
+    for (int i = 0; i < count; i++)
+    {
+        SpriteInstance &sprite = sprites[i];
+        const AnimationClip &clip = m_clips[m_playing[sprite.animator]];
+
+        sprite.animation_frame = m_frames[sprite.animator];
+        sprite.animation_cols  = clip.cols;
+        sprite.animation_rows  = clip.rows;
+    }
+}
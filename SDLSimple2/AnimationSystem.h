@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "glm/glm.hpp"
+
+class AssetPack;
+struct SpriteInstance;
+
+constexpr int ANIMATION_TICKS_PER_SECOND = 120; // Frame durations are rounded to these
+
+enum AnimationLoop : uint8_t
+{
+    ANIMATION_LOOP,      // Starts over after the last frame
+    ANIMATION_ONCE,      // Holds the last frame
+    ANIMATION_PING_PONG  // Plays back to the first frame, then forwards again
+};
+
+// Which of its set's clips an animator plays, from how its entity is moving
+enum AnimationState : uint8_t
+{
+    ANIMATION_IDLE,
+    ANIMATION_LEFT,
+    ANIMATION_RIGHT,
+    ANIMATION_STATE_COUNT
+};
+
+AnimationState const animation_state_of(glm::vec3 movement);
+
+// A clip as laid out on the timeline: one atlas frame index per tick, ping
+// pongs already unrolled into a forward and a backward pass
+struct AnimationClip
+{
+    int  first_tick = 0;
+    int  tick_count = 1;
+    int  cols = 0, rows = 0; // How the sprite's region is cut into frames
+    bool loops      = false;
+};
+
+// Sprite animation, apart from Entity. Clips (frames of a region cut into a
+// grid, how long each is shown and how the clip ends) and the sets of clips an
+// entity plays standing, walking left and walking right are read from a text
+// file (see assets/entities.anim). Each clip is sampled into a timeline of
+// frames ANIMATION_TICKS_PER_SECOND apart when it loads, so finding a frame is
+// one lookup whatever the durations.
+//
+// Animators live here, not in the entities, with their state in flat arrays.
+// advance() steps all of them in one pass with no branching per animator, and
+// write_frames() copies the results into the sprite batch by the animator
+// index each sprite carries. Animator 0 never moves and draws the whole region.
+class AnimationSystem
+{
+private:
+    std::vector<AnimationClip> m_clips;    // Clip 0 is the still one
+    std::vector<int>           m_timeline; // Frame index per tick
+    std::unordered_map<std::string, int> m_clip_indices;
+
+    std::vector<int> m_set_clips; // ANIMATION_STATE_COUNT clips per set; set 0 is all still
+    std::unordered_map<std::string, int> m_set_indices;
+
+    // ————— ANIMATORS ————— //
+    // One entry per animator in every array
+    std::vector<int>     m_animator_sets;
+    std::vector<uint8_t> m_states;  // AnimationState, set before each advance()
+    std::vector<int>     m_playing; // Clip
+    std::vector<float>   m_times;   // Into the clip
+    std::vector<int>     m_frames;
+    std::vector<int>     m_free_animators;
+
+    AssetPack* m_asset_pack = nullptr;
+
+    bool parse(std::istream &infile, const char* filepath);
+    void clear();
+
+public:
+    AnimationSystem();
+
+    // ————— METHODS ————— //
+    bool load(const char* filepath);
+    int  find_set(const std::string &name) const;
+
+    int  add_animator(int set);
+    void remove_animator(int animator);
+
+    void advance(float delta_time);
+    void write_frames(SpriteInstance* sprites, int count) const;
+
+    // ————— GETTERS ————— //
+    int const get_clip_count()     const { return (int) m_clips.size() - 1; }
+    int const get_animator_count() const { return (int) (m_animator_sets.size() - m_free_animators.size()) - 1; }
+    int const get_frame(int animator) const { return m_frames[animator]; }
+
+    // ————— SETTERS ————— //
+    void set_asset_pack(AssetPack* asset_pack) { m_asset_pack = asset_pack; }
+    void set_state(int animator, AnimationState state) { m_states[animator] = state; }
+};
@@ -0,0 +1,165 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include "AssetPack.h"
+
+#ifdef _WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+AssetPack::~AssetPack() { close(); }
+
+bool AssetPack::open(const char* pack_filepath)
+{
+    close();
+
+#ifdef _WINDOWS
+    HANDLE file = CreateFileA(pack_filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    m_file_handle    = file;
+    m_mapping_handle = mapping;
+    m_mapping        = (const unsigned char*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    m_mapping_size   = (size_t) file_size.QuadPart;
+#else
+    int file = ::open(pack_filepath, O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat file_info;
+    if (fstat(file, &file_info) != 0 || file_info.st_size == 0)
+    {
+        ::close(file);
+        return false;
+    }
+
+    // The mapping keeps its own reference to the file, so the descriptor can go
+    void* mapping = mmap(NULL, (size_t) file_info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (mapping == MAP_FAILED) return false;
+
+    m_mapping      = (const unsigned char*) mapping;
+    m_mapping_size = (size_t) file_info.st_size;
+#endif
+
+    if (m_mapping == nullptr) return false;
+
+    // Validate the header and index before trusting any offsets in it
+    asset_pack::Header header;
+    if (m_mapping_size < sizeof(header))
+    {
+        std::cout << "Asset pack " << pack_filepath << " is truncated" << std::endl;
+        close();
+        return false;
+    }
+    std::memcpy(&header, m_mapping, sizeof(header));
+
+    if (std::memcmp(header.magic, asset_pack::MAGIC, sizeof(header.magic)) != 0 ||
+        sizeof(header) + (size_t) header.entry_count * sizeof(asset_pack::Entry) > m_mapping_size)
+    {
+        std::cout << "Asset pack " << pack_filepath << " is not a valid pack" << std::endl;
+        close();
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header.entry_count; i++)
+    {
+        asset_pack::Entry entry;
+        std::memcpy(&entry, m_mapping + sizeof(header) + i * sizeof(entry), sizeof(entry));
+
+        if (entry.offset > m_mapping_size || entry.size > m_mapping_size - entry.offset)
+        {
+            std::cout << "Asset pack entry " << i << " points outside the file" << std::endl;
+            continue;
+        }
+
+        entry.name[asset_pack::NAME_LENGTH - 1] = '\0';
+
+        AssetView view;
+        view.data   = m_mapping + entry.offset;
+        view.size   = (size_t) entry.size;
+        view.kind   = entry.kind;
+        view.width  = (int) entry.width;
+        view.height = (int) entry.height;
+        m_entries[entry.name] = view;
+    }
+
+    return true;
+}
+
+void AssetPack::close()
+{
+    m_entries.clear();
+
+#ifdef _WINDOWS
+    if (m_mapping != nullptr) UnmapViewOfFile(m_mapping);
+    if (m_mapping_handle != nullptr) CloseHandle(m_mapping_handle);
+    if (m_file_handle != nullptr) CloseHandle(m_file_handle);
+    m_mapping_handle = nullptr;
+    m_file_handle    = nullptr;
+#else
+    if (m_mapping != nullptr) munmap((void*) m_mapping, m_mapping_size);
+#endif
+
+    m_mapping      = nullptr;
+    m_mapping_size = 0;
+}
+
+bool AssetPack::find(const std::string &filepath, AssetView *view) const
+{
+    auto found = m_entries.find(filepath);
+    if (found == m_entries.end()) return false;
+
+    *view = found->second;
+    return true;
+}
+
+bool read_text_asset(const AssetPack* pack, const char* filepath, std::stringstream *text)
+{
+    AssetView packed;
+    if (pack != nullptr && pack->find(filepath, &packed))
+    {
+        text->write((const char*) packed.data, packed.size);
+        return true;
+    }
+
+    std::ifstream loose(filepath);
+    if (loose.fail()) return false;
+
+    *text << loose.rdbuf();
+    return true;
+}
+
+bool TextAssetReader::next_line()
+{
+    while (std::getline(m_infile, m_line))
+    {
+        m_line_number++;
+
+        std::string::size_type comment = m_line.find('#');
+        if (comment != std::string::npos) m_line.erase(comment);
+
+        if (m_line.find_first_not_of(" \t\r\n\v\f") != std::string::npos) return true;
+    }
+    return false;
+}
+
+bool TextAssetReader::fail(const std::string &message) const
+{
+    std::cout << m_filepath << ":" << m_line_number << ": " << message << std::endl;
+    return false;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+// Layout shared with tools/asset_packer.cpp. Everything is little-endian and
+// every entry's data starts on a 16-byte boundary.
+namespace asset_pack
+{
+    constexpr char     MAGIC[8]        = { 'S', 'D', 'L', 'P', 'A', 'K', '1', '\0' };
+    constexpr int      NAME_LENGTH     = 64;
+    constexpr uint32_t DATA_ALIGNMENT  = 16;
+
+    enum EntryKind : uint32_t { RAW = 0, TEXTURE_RGBA = 1 };
+
+    struct Header
+    {
+        char     magic[8];
+        uint32_t entry_count;
+        uint32_t reserved;
+    };
+
+    struct Entry
+    {
+        char     name[NAME_LENGTH]; // Relative path, exactly as the game asks for it
+        uint32_t kind;
+        uint32_t width;             // Only meaningful for TEXTURE_RGBA
+        uint32_t height;
+        uint32_t reserved;
+        uint64_t offset;            // From the start of the file
+        uint64_t size;
+    };
+}
+
+// A view of one file inside the pack. The bytes live in the mapping and stay
+// valid for as long as the AssetPack is open.
+struct AssetView
+{
+    const unsigned char* data   = nullptr;
+    size_t               size   = 0;
+    uint32_t             kind   = asset_pack::RAW;
+    int                  width  = 0;
+    int                  height = 0;
+};
+
+// Read-only virtual file system over a single memory-mapped archive built by
+// tools/asset_packer.cpp. Textures in it are already decoded to RGBA, so
+// loading one is a lookup rather than a file open plus a PNG decode.
+class AssetPack
+{
+private:
+    const unsigned char* m_mapping = nullptr;
+    size_t               m_mapping_size = 0;
+
+#ifdef _WINDOWS
+    void* m_file_handle    = nullptr;
+    void* m_mapping_handle = nullptr;
+#endif
+
+    std::unordered_map<std::string, AssetView> m_entries;
+
+    void close();
+
+public:
+    // ————— METHODS ————— //
+    AssetPack() {}
+    AssetPack(const AssetPack &) = delete;
+    AssetPack &operator=(const AssetPack &) = delete;
+    ~AssetPack();
+
+    bool open(const char* pack_filepath);
+    bool find(const std::string &filepath, AssetView *view) const;
+
+    // ————— GETTERS ————— //
+    bool const is_open()         const { return m_mapping != nullptr; }
+    int  const get_entry_count() const { return (int) m_entries.size(); }
+};
+
+// Reads a whole text file into text: the copy in the pack if it has one (pack
+// may be null), otherwise the loose file. False, with nothing read, if neither exists.
+bool read_text_asset(const AssetPack* pack, const char* filepath, std::stringstream *text);
+
+// Steps through a text asset a line at a time with # comments cut off, skipping
+// lines left blank, for the game's line-based data files (behaviour trees,
+// utility profiles, spawn tables, animation clips)
+class TextAssetReader
+{
+private:
+    std::istream &m_infile;
+    const char*   m_filepath;
+    std::string   m_line;
+    int           m_line_number = 0;
+
+public:
+    TextAssetReader(std::istream &infile, const char* filepath) : m_infile(infile), m_filepath(filepath) { }
+
+    // ————— METHODS ————— //
+    bool next_line(); // False once there are none left
+
+    // Prints "file:line: message" and returns false, so a parser can return fail(...)
+    bool fail(const std::string &message) const;
+
+    // ————— GETTERS ————— //
+    std::string const &get_line()        const { return m_line; } // Leading whitespace kept, for indentation
+    int         const  get_line_number() const { return m_line_number; }
+};
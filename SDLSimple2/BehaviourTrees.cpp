@@ -0,0 +1,357 @@
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include "BehaviourTrees.h"
+#include "AssetPack.h"
+#include "NavGraph.h"
+#include "Profiler.h"
+#include "FrameStats.h"
+
+namespace
+{
+    enum NodeParameter { PARAMETER_NONE, PARAMETER_VALUE, PARAMETER_STATE, PARAMETER_STIMULUS };
+
+    struct NodeName
+    {
+        const char*       name;
+        BehaviourNodeKind kind;
+        NodeParameter     parameter;
+    };
+
+    const NodeName NODE_NAMES[] =
+    {
+        { "selector",       NODE_SELECTOR,       PARAMETER_NONE     },
+        { "sequence",       NODE_SEQUENCE,       PARAMETER_NONE     },
+        { "inverter",       NODE_INVERTER,       PARAMETER_NONE     },
+        { "player_within",  NODE_PLAYER_WITHIN,  PARAMETER_VALUE    },
+        { "can_see_player", NODE_CAN_SEE_PLAYER, PARAMETER_NONE     },
+        { "senses",         NODE_SENSES,         PARAMETER_STIMULUS },
+        { "on_ground",      NODE_ON_GROUND,      PARAMETER_NONE     },
+        { "blocked",        NODE_BLOCKED,        PARAMETER_NONE     },
+        { "state_is",       NODE_STATE_IS,       PARAMETER_STATE    },
+        { "walk_left",      NODE_WALK_LEFT,      PARAMETER_NONE     },
+        { "walk_right",     NODE_WALK_RIGHT,     PARAMETER_NONE     },
+        { "chase_player",   NODE_CHASE_PLAYER,   PARAMETER_NONE     },
+        { "investigate",    NODE_INVESTIGATE,    PARAMETER_NONE     },
+        { "stop",           NODE_STOP,           PARAMETER_NONE     },
+        { "jump",           NODE_JUMP,           PARAMETER_NONE     },
+        { "set_state",      NODE_SET_STATE,      PARAMETER_STATE    },
+        { "wait",           NODE_WAIT,           PARAMETER_VALUE    },
+    };
+
+    // Same order as AIState and StimulusType
+    const char* const STATE_NAMES[]    = { "walking", "idle", "attacking" };
+    const char* const STIMULUS_NAMES[] = { "player", "noise", "ally_death" };
+
+    bool is_composite(BehaviourNodeKind kind)
+    {
+        return kind == NODE_SELECTOR || kind == NODE_SEQUENCE || kind == NODE_INVERTER;
+    }
+
+    BehaviourStatus passed(bool condition) { return condition ? BEHAVIOUR_SUCCESS : BEHAVIOUR_FAILURE; }
+}
+
+bool BehaviourTrees::load(const char* filepath)
+{
+    std::stringstream infile;
+    if (!read_text_asset(m_asset_pack, filepath, &infile))
+    {
+        std::cout << "No behaviour trees at " << filepath << ", using built-in AI" << std::endl;
+        return false;
+    }
+
+    if (parse(infile, filepath)) return true;
+
+    // A half-loaded file would leave some enemies with the wrong tree
+    m_nodes.clear();
+    m_tree_roots.clear();
+    m_tree_indices.clear();
+    return false;
+}
+
+// One node per line, children indented further than their parent:
+//
+//   tree guard
+//       selector
+//           sequence
+//               state_is walking
+//               chase_player
+//
+// Lines are already in depth-first order, so each node is appended as it is
+// read and only its end has to be filled in once its subtree is closed.
+bool BehaviourTrees::parse(std::istream &infile, const char* filepath)
+{
+    struct OpenNode { int indent, index; };
+    std::vector<OpenNode> open;
+
+    TextAssetReader reader(infile, filepath);
+
+    // Pops every open node at or deeper than indent, checking child counts
+    auto close = [&](int indent)
+    {
+        while (!open.empty() && open.back().indent >= indent)
+        {
+            int index = open.back().index;
+            open.pop_back();
+
+            BehaviourNode &node = m_nodes[index];
+            node.end = (int) m_nodes.size();
+
+            int children = 0;
+            for (int child = index + 1; child < node.end; child = m_nodes[child].end) children++;
+
+            if (is_composite(node.kind) && children == 0)    return reader.fail("composite node has no children");
+            if (node.kind == NODE_INVERTER && children != 1) return reader.fail("inverter needs exactly one child");
+        }
+        return true;
+    };
+
+    bool in_tree = false;
+    while (reader.next_line())
+    {
+        const std::string &line = reader.get_line();
+
+        int indent = 0;
+        while (indent < (int) line.size() && (line[indent] == ' ' || line[indent] == '\t')) indent++;
+
+        std::istringstream fields(line);
+        std::string name;
+        fields >> name;
+
+        if (name == "tree")
+        {
+            if (!close(0)) return false;
+            if (in_tree && m_tree_roots.back() == (int) m_nodes.size()) return reader.fail("previous tree is empty");
+
+            std::string tree_name;
+            if (!(fields >> tree_name)) return reader.fail("tree needs a name");
+            if (m_tree_indices.count(tree_name)) return reader.fail("tree " + tree_name + " is defined twice");
+
+            m_tree_indices[tree_name] = (int) m_tree_roots.size();
+            m_tree_roots.push_back((int) m_nodes.size());
+            in_tree = true;
+            continue;
+        }
+
+        if (!in_tree) return reader.fail("node outside of a tree");
+        if (!close(indent)) return false;
+
+        if (open.empty() && m_tree_roots.back() != (int) m_nodes.size()) return reader.fail("a tree has one root node");
+        if (!open.empty() && !is_composite(m_nodes[open.back().index].kind)) return reader.fail(name + "'s parent cannot have children");
+
+        const NodeName* found = nullptr;
+        for (const NodeName &node_name : NODE_NAMES)
+        {
+            if (name == node_name.name) found = &node_name;
+        }
+        if (found == nullptr) return reader.fail("unknown node " + name);
+
+        BehaviourNode node;
+        node.kind = found->kind;
+
+        if (found->parameter == PARAMETER_VALUE && !(fields >> node.value)) return reader.fail(name + " needs a number");
+        if (found->parameter == PARAMETER_STATE)
+        {
+            std::string state;
+            fields >> state;
+
+            node.state = -1;
+            for (int i = 0; i < (int) (sizeof(STATE_NAMES) / sizeof(STATE_NAMES[0])); i++)
+            {
+                if (state == STATE_NAMES[i]) node.state = i;
+            }
+            if (node.state < 0) return reader.fail(name + " needs walking, idle or attacking");
+        }
+        if (found->parameter == PARAMETER_STIMULUS)
+        {
+            std::string stimulus;
+            fields >> stimulus;
+
+            node.state = -1;
+            for (int i = 0; i < STIMULUS_TYPE_COUNT; i++)
+            {
+                if (stimulus == STIMULUS_NAMES[i]) node.state = i;
+            }
+            if (node.state < 0) return reader.fail(name + " needs player, noise or ally_death");
+        }
+
+        open.push_back({ indent, (int) m_nodes.size() });
+        m_nodes.push_back(node);
+    }
+
+    if (!close(0)) return false;
+    if (in_tree && m_tree_roots.back() == (int) m_nodes.size()) return reader.fail("last tree is empty");
+    return true;
+}
+
+int BehaviourTrees::find_tree(const std::string &name) const
+{
+    auto found = m_tree_indices.find(name);
+    return found == m_tree_indices.end() ? -1 : found->second;
+}
+
+void BehaviourTrees::add_agent(int tree, Entity* entity)
+{
+    m_agent_states.push_back(0);
+    m_agent_running_nodes.push_back(-1);
+    m_agent_timers.push_back(0.0f);
+
+    int agent = m_agents.add(tree, entity, [this](int from, int to) { move_agent(from, to); });
+    m_agent_states[agent]        = (uint8_t) entity->get_ai_state();
+    m_agent_running_nodes[agent] = -1;
+    m_agent_timers[agent]        = 0.0f;
+
+    entity->set_has_external_ai(true);
+}
+
+bool BehaviourTrees::remove_agent(Entity* entity)
+{
+    if (!m_agents.remove(entity, [this](int from, int to) { move_agent(from, to); })) return false;
+
+    m_agent_states.pop_back();
+    m_agent_running_nodes.pop_back();
+    m_agent_timers.pop_back();
+
+    entity->set_has_external_ai(false);
+    return true;
+}
+
+void BehaviourTrees::clear_agents()
+{
+    for (Entity* entity : m_agents.get_entities()) entity->set_has_external_ai(false);
+
+    m_agents.clear();
+    m_agent_states.clear();
+    m_agent_running_nodes.clear();
+    m_agent_timers.clear();
+}
+
+// Follows AgentGroups as it shifts agents between slots
+void BehaviourTrees::move_agent(int from, int to)
+{
+    m_agent_states[to]        = m_agent_states[from];
+    m_agent_running_nodes[to] = m_agent_running_nodes[from];
+    m_agent_timers[to]        = m_agent_timers[from];
+}
+
+void BehaviourTrees::tick(float delta_time)
+{
+    PROFILE_ZONE("behaviour trees");
+
+    int decisions = 0;
+    for (int tree = 0; tree < get_tree_count(); tree++)
+    {
+        int root = m_tree_roots[tree];
+
+        for (int agent = m_agents.get_group_start(tree); agent < m_agents.get_group_end(tree); agent++)
+        {
+            const Entity* entity = m_agents.get_entity(agent);
+            if (!entity->get_is_active() || !entity->get_update_due() || entity->get_is_sleeping()) continue;
+
+            // Anything still running has to be reached again this tick to keep going
+            m_resuming_node = m_agent_running_nodes[agent];
+            m_agent_running_nodes[agent] = -1;
+
+            evaluate(root, agent, delta_time * entity->get_update_interval());
+            decisions++;
+        }
+    }
+    frame_stats::current().ai_decisions += decisions;
+}
+
+BehaviourStatus BehaviourTrees::evaluate(int node_index, int agent, float delta_time)
+{
+    const BehaviourNode &node = m_nodes[node_index];
+    Entity* entity = m_agents.get_entity(agent);
+    const Percept &percept = entity->get_percept();
+
+    switch (node.kind)
+    {
+        case NODE_SELECTOR:
+            for (int child = node_index + 1; child < node.end; child = m_nodes[child].end)
+            {
+                BehaviourStatus status = evaluate(child, agent, delta_time);
+                if (status != BEHAVIOUR_FAILURE) return status;
+            }
+            return BEHAVIOUR_FAILURE;
+
+        case NODE_SEQUENCE:
+            for (int child = node_index + 1; child < node.end; child = m_nodes[child].end)
+            {
+                BehaviourStatus status = evaluate(child, agent, delta_time);
+                if (status != BEHAVIOUR_SUCCESS) return status;
+            }
+            return BEHAVIOUR_SUCCESS;
+
+        case NODE_INVERTER:
+        {
+            BehaviourStatus status = evaluate(node_index + 1, agent, delta_time);
+            if (status == BEHAVIOUR_RUNNING) return status;
+            return passed(status == BEHAVIOUR_FAILURE);
+        }
+
+        case NODE_PLAYER_WITHIN:
+            return passed(percept.senses[STIMULUS_PLAYER] && percept.distances[STIMULUS_PLAYER] < node.value);
+
+        case NODE_CAN_SEE_PLAYER:
+            return passed(percept.can_see_player);
+
+        case NODE_SENSES:
+            return passed(percept.senses[node.state]);
+
+        case NODE_ON_GROUND:
+            return passed(entity->get_collided_bottom());
+
+        case NODE_BLOCKED:
+            return passed(entity->get_collided_left() || entity->get_collided_right());
+
+        case NODE_STATE_IS:
+            return passed(m_agent_states[agent] == node.state);
+
+        case NODE_WALK_LEFT:
+            entity->set_movement(glm::vec3(-1.0f, 0.0f, 0.0f));
+            return BEHAVIOUR_SUCCESS;
+
+        case NODE_WALK_RIGHT:
+            entity->set_movement(glm::vec3(1.0f, 0.0f, 0.0f));
+            return BEHAVIOUR_SUCCESS;
+
+        case NODE_CHASE_PLAYER:
+            steer_towards(m_nav_graph, entity, percept.positions[STIMULUS_PLAYER]);
+            return BEHAVIOUR_SUCCESS;
+
+        case NODE_INVESTIGATE:
+        {
+            glm::vec3 target;
+            if (!percept.nearest_disturbance(&target)) return BEHAVIOUR_FAILURE;
+
+            steer_towards(m_nav_graph, entity, target);
+            return BEHAVIOUR_SUCCESS;
+        }
+
+        case NODE_STOP:
+            entity->set_movement(glm::vec3(0.0f));
+            return BEHAVIOUR_SUCCESS;
+
+        case NODE_JUMP:
+            entity->jump();
+            return BEHAVIOUR_SUCCESS;
+
+        case NODE_SET_STATE:
+            m_agent_states[agent] = (uint8_t) node.state;
+            entity->set_ai_state((AIState) node.state);
+            return BEHAVIOUR_SUCCESS;
+
+        case NODE_WAIT:
+            if (m_resuming_node != node_index) m_agent_timers[agent] = 0.0f;
+
+            m_agent_timers[agent] += delta_time;
+            if (m_agent_timers[agent] < node.value)
+            {
+                m_agent_running_nodes[agent] = node_index;
+                return BEHAVIOUR_RUNNING;
+            }
+            return BEHAVIOUR_SUCCESS;
+    }
+    return BEHAVIOUR_FAILURE;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "Entity.h"
+#include "AgentGroups.h"
+
+class AssetPack;
+class NavGraph;
+
+enum BehaviourStatus { BEHAVIOUR_SUCCESS, BEHAVIOUR_FAILURE, BEHAVIOUR_RUNNING };
+
+enum BehaviourNodeKind : uint8_t
+{
+    // ————— COMPOSITES ————— //
+    NODE_SELECTOR,       // First child that does not fail
+    NODE_SEQUENCE,       // Every child until one does not succeed
+    NODE_INVERTER,       // Exactly one child, success and failure swapped
+    // ————— CONDITIONS ————— //
+    NODE_PLAYER_WITHIN,  // value: distance
+    NODE_CAN_SEE_PLAYER, // Nothing solid in between
+    NODE_SENSES,         // state: StimulusType
+    NODE_ON_GROUND,
+    NODE_BLOCKED,        // Ran into something left or right last step
+    NODE_STATE_IS,       // state: AIState
+    // ————— ACTIONS ————— //
+    NODE_WALK_LEFT,
+    NODE_WALK_RIGHT,
+    NODE_CHASE_PLAYER,   // To where the player was last sensed, along the NavGraph if set
+    NODE_INVESTIGATE,    // Towards the nearest noise or ally death, failing if there is none
+    NODE_STOP,
+    NODE_JUMP,
+    NODE_SET_STATE,      // state: AIState
+    NODE_WAIT            // value: seconds, running until they have passed
+};
+
+// One node of a flattened tree. Every tree is stored depth-first in a single
+// shared array, so a node's first child is the element right after it and
+// each child's end is where its next sibling starts.
+struct BehaviourNode
+{
+    BehaviourNodeKind kind;
+    int   end   = 0;    // One past the last node of this subtree
+    float value = 0.0f;
+    int   state = 0;    // AIState or StimulusType
+};
+
+// Data-driven enemy AI, loaded from a text file of named trees (see
+// assets/enemies.bt). Nodes are plain structs evaluated by one switch, so a
+// tick makes no virtual calls and walks memory in order. Agents are kept
+// grouped by tree with their blackboards in parallel arrays, and tick() runs
+// each group as one batch. Entities given a tree stop using ai_activate.
+// Conditions read the entity's percept, so Perception has to be updated too.
+class BehaviourTrees
+{
+private:
+    std::vector<BehaviourNode> m_nodes;
+    std::vector<int>           m_tree_roots;
+    std::unordered_map<std::string, int> m_tree_indices;
+
+    // ————— BLACKBOARDS ————— //
+    // Grouped by tree; the arrays below have one entry per agent slot in it
+    AgentGroups          m_agents;
+    std::vector<uint8_t> m_agent_states;        // AIState
+    std::vector<int>     m_agent_running_nodes; // Node that returned running last tick, or -1
+    std::vector<float>   m_agent_timers;        // Time spent in that node so far
+
+    int m_resuming_node = -1; // The current agent's running node from last tick
+
+    AssetPack* m_asset_pack = nullptr;
+    NavGraph*  m_nav_graph  = nullptr; // Chasing and investigating follow it when set
+
+    bool parse(std::istream &infile, const char* filepath);
+    void move_agent(int from, int to);
+    BehaviourStatus evaluate(int node_index, int agent, float delta_time);
+
+public:
+    // ————— METHODS ————— //
+    bool load(const char* filepath);
+    int  find_tree(const std::string &name) const;
+
+    void add_agent(int tree, Entity* entity);
+    bool remove_agent(Entity* entity); // False if it wasn't one
+    void clear_agents();
+    void tick(float delta_time);
+
+    // ————— GETTERS ————— //
+    int const get_tree_count()  const { return (int) m_tree_roots.size();     }
+    int const get_node_count()  const { return (int) m_nodes.size();          }
+    int const get_agent_count() const { return m_agents.get_count();          }
+
+    // ————— SETTERS ————— //
+    void set_asset_pack(AssetPack* asset_pack) { m_asset_pack = asset_pack; }
+    void set_nav_graph(NavGraph* nav_graph)    { m_nav_graph  = nav_graph;  }
+};
@@ -0,0 +1,46 @@
+#include "Camera.h"
+#include "GLState.h"
+
+Camera::Camera()
+{
+    m_block.view_matrix            = glm::mat4(1.0f);
+    m_block.projection_matrix      = glm::mat4(1.0f);
+    m_block.view_projection_matrix = glm::mat4(1.0f);
+    m_block.viewport               = glm::vec4(0.0f);
+    m_block.time                   = glm::vec4(0.0f);
+}
+
+bool Camera::is_buffer_supported()
+{
+    // Uniform blocks arrived with GL 3.1 / GLSL 1.40
+    return gl_state::gl_version_at_least(3, 1);
+}
+
+void Camera::initialise()
+{
+    if (!is_buffer_supported()) return;
+
+    glGenBuffers(1, &m_buffer_id);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer_id);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), &m_block, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, BINDING_POINT, m_buffer_id);
+}
+
+void Camera::upload(float time)
+{
+    // Computed once here instead of once per vertex in the shaders
+    m_block.view_projection_matrix = m_block.projection_matrix * m_block.view_matrix;
+    m_block.time.x = time;
+
+    if (m_buffer_id == 0) return;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer_id);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &m_block);
+    gl_state::count_upload(sizeof(CameraBlock));
+}
+
+void Camera::shutdown()
+{
+    if (m_buffer_id != 0) glDeleteBuffers(1, &m_buffer_id);
+    m_buffer_id = 0;
+}
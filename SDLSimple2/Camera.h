@@ -0,0 +1,51 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include "glm/mat4x4.hpp"
+
+// Mirrors the std140 "Camera" uniform block declared in the vertex shaders.
+// Every member is a multiple of 16 bytes so the C++ and GLSL layouts agree.
+struct CameraBlock
+{
+    glm::mat4 view_matrix;
+    glm::mat4 projection_matrix;
+    glm::mat4 view_projection_matrix;
+    glm::vec4 viewport;          // x, y, width, height in pixels
+    glm::vec4 time;              // x = seconds since start, rest unused
+};
+
+// Per-frame camera state, uploaded once and shared by every program. On
+// contexts with uniform buffers (GL 3.1+) it lives in a UBO bound to
+// BINDING_POINT and programs never touch it; on older contexts (e.g. the
+// 2.1 context macOS hands out) each program takes the precomputed
+// view-projection matrix as a plain uniform through ShaderProgram::set_camera.
+class Camera
+{
+private:
+    CameraBlock m_block;
+    GLuint      m_buffer_id = 0;
+
+public:
+    static constexpr GLuint BINDING_POINT = 0;
+    static bool is_buffer_supported();
+
+    // ————— METHODS ————— //
+    Camera();
+
+    void initialise();
+    void upload(float time);
+    void shutdown();
+
+    // ————— GETTERS ————— //
+    CameraBlock const &get_block()                  const { return m_block; }
+    glm::mat4   const get_view_projection_matrix() const { return m_block.view_projection_matrix; }
+
+    // ————— SETTERS ————— //
+    void set_view_matrix(const glm::mat4 &matrix)       { m_block.view_matrix = matrix; }
+    void set_projection_matrix(const glm::mat4 &matrix) { m_block.projection_matrix = matrix; }
+    void set_viewport(float x, float y, float width, float height) { m_block.viewport = glm::vec4(x, y, width, height); }
+};
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cmath>
+#include "Crowd.h"
+#include "Entity.h"
+#include "Profiler.h"
+
+namespace
+{
+    // Whether the tile Map::is_solid would look at for this point is solid
+    bool solid_at(const Map* map, float x, float y)
+    {
+        float tile_size = map->get_tile_size();
+        int tile_x = (int) std::floor((x + tile_size / 2) / tile_size);
+        int tile_y = (int) (-(std::ceil(y - tile_size / 2)) / tile_size);
+        return map->is_solid_tile(tile_x, tile_y);
+    }
+}
+
+int const Crowd::column_of(float x) const
+{
+    int column = (int) std::floor((x - m_left_bound) / m_column_width);
+    return std::clamp(column, 0, m_column_count - 1);
+}
+
+// Counting sort of the active agents by column, as Perception indexes its
+// stimuli, then their positions and sizes copied out in that order
+void Crowd::build_index(Entity* agents, int agent_count, const Map* map)
+{
+    float widest = 0.0f;
+    for (int i = 0; i < agent_count; i++)
+    {
+        if (agents[i].get_is_active()) widest = std::max(widest, agents[i].get_width());
+    }
+
+    m_left_bound   = map->get_left_bound();
+    m_column_width = std::max(widest, 0.01f);
+    m_column_count = std::max(1, (int) std::ceil((map->get_right_bound() - m_left_bound) / m_column_width));
+
+    m_column_starts.assign(m_column_count + 1, 0);
+    m_agent_columns.resize(agent_count);
+
+    for (int i = 0; i < agent_count; i++)
+    {
+        m_agent_columns[i] = agents[i].get_is_active() ? column_of(agents[i].get_position().x) : -1;
+        if (m_agent_columns[i] >= 0) m_column_starts[m_agent_columns[i]]++;
+    }
+    for (int column = 1; column <= m_column_count; column++) m_column_starts[column] += m_column_starts[column - 1];
+
+    int slot_count = m_column_starts[m_column_count];
+    m_slot_agents.resize(slot_count);
+    for (int i = agent_count - 1; i >= 0; i--)
+    {
+        if (m_agent_columns[i] >= 0) m_slot_agents[--m_column_starts[m_agent_columns[i]]] = i;
+    }
+
+    m_xs.resize(slot_count);
+    m_ys.resize(slot_count);
+    m_half_widths.resize(slot_count);
+    m_half_heights.resize(slot_count);
+    m_pushes.resize(slot_count);
+
+    for (int slot = 0; slot < slot_count; slot++)
+    {
+        const Entity &agent = agents[m_slot_agents[slot]];
+        m_xs[slot]           = agent.get_position().x;
+        m_ys[slot]           = agent.get_position().y;
+        m_half_widths[slot]  = agent.get_width()  / 2.0f;
+        m_half_heights[slot] = agent.get_height() / 2.0f;
+    }
+}
+
+// Each overlapping pair is split evenly, each side taking its half of it in
+// its own push, so the two agree without either writing to the other. Agents
+// on exactly the same x part in index order.
+void Crowd::solve(int first_slot, int last_slot, const Map* map)
+{
+    for (int slot = first_slot; slot < last_slot; slot++)
+    {
+        float x = m_xs[slot],
+              y = m_ys[slot];
+        int column = column_of(x);
+        float push = 0.0f;
+
+        for (int neighbour_column = std::max(column - 1, 0); neighbour_column <= std::min(column + 1, m_column_count - 1); neighbour_column++)
+        {
+            for (int other = m_column_starts[neighbour_column]; other < m_column_starts[neighbour_column + 1]; other++)
+            {
+                if (other == slot) continue;
+
+                float overlap_y = m_half_heights[slot] + m_half_heights[other] - std::fabs(y - m_ys[other]);
+                if (overlap_y <= 0.0f) continue;
+
+                float offset    = x - m_xs[other];
+                float overlap_x = m_half_widths[slot] + m_half_widths[other] - std::fabs(offset);
+                if (overlap_x <= 0.0f) continue;
+
+                float side = offset != 0.0f ? std::copysign(1.0f, offset)
+                                            : (m_slot_agents[slot] < m_slot_agents[other] ? -1.0f : 1.0f);
+                push += side * overlap_x * 0.5f * CROWD_STIFFNESS;
+            }
+        }
+
+        push = std::clamp(push, -CROWD_MAX_PUSH, CROWD_MAX_PUSH);
+
+        // Probed at the leading side's centre height, as Entity::check_collision_x does
+        float edge = x + push + std::copysign(m_half_widths[slot], push);
+        if (push != 0.0f && solid_at(map, edge, y)) push = 0.0f;
+
+        m_pushes[slot] = push;
+    }
+}
+
+void Crowd::separate(Entity* agents, int agent_count, const Map* map)
+{
+    PROFILE_ZONE("crowd separation");
+
+    build_index(agents, agent_count, map);
+
+    int slot_count = (int) m_slot_agents.size();
+    solve(0, slot_count, map);
+
+    m_pushed_count = 0;
+    for (int slot = 0; slot < slot_count; slot++)
+    {
+        if (m_pushes[slot] == 0.0f) continue;
+
+        agents[m_slot_agents[slot]].nudge(glm::vec3(m_pushes[slot], 0.0f, 0.0f));
+        m_pushed_count++;
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Map.h"
+
+class Entity;
+
+constexpr float CROWD_STIFFNESS = 0.8f;  // Share of an overlap taken out per step; short of all of it so agents squeezed from both sides settle instead of overshooting
+constexpr float CROWD_MAX_PUSH  = 0.05f; // Furthest one step moves an agent, a few times an enemy's walking speed
+
+// Keeps agents (enemies) from standing inside each other, which Entity::update
+// doesn't do since enemies only collide with the player. Every step the active
+// agents are sorted into columns as wide as the widest of them, so overlapping
+// agents are always in the same or neighbouring columns, and each agent pushed
+// away from whatever it overlaps, along x only: y belongs to gravity and the
+// floor. It never pushes an agent into a solid tile.
+//
+// Each agent's push is gathered from where everyone was before any of them
+// moved, and only written back once all are known, so the result doesn't
+// depend on the order agents are visited in and any range of them could be
+// solved on its own thread.
+class Crowd
+{
+private:
+    // ————— SPATIAL INDEX ————— //
+    // Column c holds slots m_column_starts[c] up to m_column_starts[c + 1].
+    // Slots keep the agents' own order within a column.
+    int   m_column_count = 0;
+    float m_left_bound   = 0.0f,
+          m_column_width = 1.0f;
+    std::vector<int> m_column_starts;
+    std::vector<int> m_agent_columns;
+
+    // ————— SLOTS ————— //
+    // The agents in column order, copied out so neighbours sit next to each other
+    std::vector<int>   m_slot_agents;
+    std::vector<float> m_xs, m_ys;
+    std::vector<float> m_half_widths, m_half_heights;
+    std::vector<float> m_pushes;
+
+    int m_pushed_count = 0;
+
+    int  const column_of(float x) const;
+    void build_index(Entity* agents, int agent_count, const Map* map);
+    void solve(int first_slot, int last_slot, const Map* map);
+
+public:
+    // ————— METHODS ————— //
+    // Pushes overlapping active agents apart. Pushing wakes a sleeping agent.
+    void separate(Entity* agents, int agent_count, const Map* map);
+
+    // ————— GETTERS ————— //
+    int const get_pushed_count() const { return m_pushed_count; } // By the last separate()
+};
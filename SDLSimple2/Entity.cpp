@@ -12,16 +12,21 @@
 #include "glm/gtc/matrix_transform.hpp"
 #include "ShaderProgram.h"
 #include "Entity.h"
+#include "GLState.h"
+#include "Profiler.h"
+#include "FrameStats.h"
+#include "GameEvents.h"
 
-void Entity::ai_activate(Entity *player)
+void Entity::ai_activate()
 {
+    frame_stats::current().ai_decisions++;
     switch (m_ai_type)
     {
         case WALKER:
             ai_walk();
             break;
         case GUARD:
-            ai_guard(player);
+            ai_guard();
             break;
         case JUMPER:
             ai_jump();
@@ -36,15 +41,17 @@ void Entity::ai_walk()
     m_movement = glm::vec3(-1.0f, 0.0f, 0.0f);
 }
 
-void Entity::ai_guard(Entity *player)
+void Entity::ai_guard()
 {
     switch (m_ai_state) {
         case IDLE:
-            if (glm::distance(m_position, player->get_position()) < 3.0f) m_ai_state = WALKING;
+            // Close enough and not behind a wall
+            if (m_percept.can_see_player && m_percept.distances[STIMULUS_PLAYER] < 3.0f) m_ai_state = WALKING;
             break;
             
         case WALKING:
-            if (m_position.x > player->get_position().x) {
+            // Heads for wherever the player was last sensed
+            if (m_position.x > m_percept.positions[STIMULUS_PLAYER].x) {
                 m_movement = glm::vec3(-1.0f, 0.0f, 0.0f);
             } else {
                 m_movement = glm::vec3(1.0f, 0.0f, 0.0f);
@@ -65,71 +72,47 @@ void Entity::ai_jump() {
 }
 // Default constructor
 Entity::Entity()
-    : m_position(0.0f), m_movement(0.0f), m_scale(1.0f, 1.0f, 0.0f), m_model_matrix(1.0f),
-    m_speed(0.0f), m_animation_cols(0), m_animation_frames(0), m_animation_index(0),
-    m_animation_rows(0), m_animation_indices(nullptr), m_animation_time(0.0f),
-    m_texture_id(0), m_velocity(0.0f), m_acceleration(0.0f), m_width(0.0f), m_height(0.0f)
+    : m_position(0.0f), m_movement(0.0f), m_scale(1.0f, 1.0f, 0.0f),
+    m_speed(0.0f), m_region(), m_velocity(0.0f), m_acceleration(0.0f), m_width(0.0f), m_height(0.0f)
 {
-    // Initialize m_walking with zeros or any default value
-    for (int i = 0; i < SECONDS_PER_FRAME; ++i)
-        for (int j = 0; j < SECONDS_PER_FRAME; ++j) m_walking[i][j] = 0;
-}
-
-// Parameterized constructor
-Entity::Entity(GLuint texture_id, float speed, glm::vec3 acceleration, float jump_power, int walking[4][4], float animation_time,
-    int animation_frames, int animation_index, int animation_cols,
-    int animation_rows, float width, float height, EntityType EntityType)
-    : m_position(0.0f), m_movement(0.0f), m_scale(1.0f, 1.0f, 0.0f), m_model_matrix(1.0f),
-    m_speed(speed),m_acceleration(acceleration), m_jumping_power(jump_power), m_animation_cols(animation_cols),
-    m_animation_frames(animation_frames), m_animation_index(animation_index),
-    m_animation_rows(animation_rows), m_animation_indices(nullptr),
-    m_animation_time(animation_time), m_texture_id(texture_id), m_velocity(0.0f),
-    m_width(width), m_height(height), m_entity_type(EntityType)
-{
-    face_right();
-    set_walking(walking);
 }
 
 // Simpler constructor for partial initialization
-Entity::Entity(GLuint texture_id, float speed,  float width, float height, EntityType EntityType)
-    : m_position(0.0f), m_movement(0.0f), m_scale(1.0f, 1.0f, 0.0f), m_model_matrix(1.0f),
-    m_speed(speed), m_animation_cols(0), m_animation_frames(0), m_animation_index(0),
-    m_animation_rows(0), m_animation_indices(nullptr), m_animation_time(0.0f),
-    m_texture_id(texture_id), m_velocity(0.0f), m_acceleration(0.0f), m_width(width), m_height(height),m_entity_type(EntityType)
+Entity::Entity(AtlasRegion region, float speed,  float width, float height, EntityType EntityType)
+    : m_position(0.0f), m_movement(0.0f), m_scale(1.0f, 1.0f, 0.0f),
+    m_speed(speed), m_region(region), m_velocity(0.0f), m_acceleration(0.0f), m_width(width), m_height(height),m_entity_type(EntityType)
 {
-    // Initialize m_walking with zeros or any default value
-    for (int i = 0; i < SECONDS_PER_FRAME; ++i)
-        for (int j = 0; j < SECONDS_PER_FRAME; ++j) m_walking[i][j] = 0;
 }
 
 
-Entity::Entity(GLuint texture_id, float speed, float width, float height, EntityType EntityType, AIType AIType, AIState AIState): m_position(0.0f), m_movement(0.0f), m_scale(1.0f, 1.0f, 0.0f), m_model_matrix(1.0f),
-m_speed(speed), m_animation_cols(0), m_animation_frames(0), m_animation_index(0),
-m_animation_rows(0), m_animation_indices(nullptr), m_animation_time(0.0f),
-m_texture_id(texture_id), m_velocity(0.0f), m_acceleration(0.0f), m_width(width), m_height(height),m_entity_type(EntityType), m_ai_type(AIType), m_ai_state(AIState)
+Entity::Entity(AtlasRegion region, float speed, float width, float height, EntityType EntityType, AIType AIType, AIState AIState): m_position(0.0f), m_movement(0.0f), m_scale(1.0f, 1.0f, 0.0f),
+m_speed(speed), m_region(region), m_velocity(0.0f), m_acceleration(0.0f), m_width(width), m_height(height),m_entity_type(EntityType), m_ai_type(AIType), m_ai_state(AIState)
 {
-// Initialize m_walking with zeros or any default value
-for (int i = 0; i < SECONDS_PER_FRAME; ++i)
-    for (int j = 0; j < SECONDS_PER_FRAME; ++j) m_walking[i][j] = 0;
 }
 
 Entity::~Entity() { }
 
-void Entity::draw_sprite_from_texture_atlas(ShaderProgram* program, GLuint texture_id, int index)
+void Entity::draw_sprite_from_texture_atlas(ShaderProgram* program, const SpriteInstance &sprite)
 {
+    const AtlasRegion &region = sprite.region;
+    int index = sprite.animation_frame;
+    
     // Step 1: Calculate the UV location of the indexed frame
-    float u_coord = (float)(index % m_animation_cols) / (float)m_animation_cols;
-    float v_coord = (float)(index / m_animation_cols) / (float)m_animation_rows;
+    float u_coord = (float)(index % sprite.animation_cols) / (float)sprite.animation_cols;
+    float v_coord = (float)(index / sprite.animation_cols) / (float)sprite.animation_rows;
 
     // Step 2: Calculate its UV size
-    float width = 1.0f / (float)m_animation_cols;
-    float height = 1.0f / (float)m_animation_rows;
+    float width = 1.0f / (float)sprite.animation_cols;
+    float height = 1.0f / (float)sprite.animation_rows;
 
-    // Step 3: Just as we have done before, match the texture coordinates to the vertices
+    // Step 3: Just as we have done before, match the texture coordinates to the vertices,
+    //         then move them into the region this spritesheet occupies on its atlas page
+    float left   = region.u(u_coord),         right  = region.u(u_coord + width);
+    float top    = region.v(v_coord),         bottom = region.v(v_coord + height);
     float tex_coords[] =
     {
-        u_coord, v_coord + height, u_coord + width, v_coord + height, u_coord + width, v_coord,
-        u_coord, v_coord + height, u_coord + width, v_coord, u_coord, v_coord
+        left, bottom, right, bottom, right, top,
+        left, bottom, right, top, left, top
     };
 
     float vertices[] =
@@ -138,23 +121,22 @@ void Entity::draw_sprite_from_texture_atlas(ShaderProgram* program, GLuint textu
         -0.5, -0.5, 0.5,  0.5, -0.5, 0.5
     };
 
-    // Step 4: And render
-    glBindTexture(GL_TEXTURE_2D, texture_id);
+    // Step 4: And render. Both attributes stay enabled between draws since
+    //         every draw re-points them, so the state cache elides the enables
+    gl_state::bind_texture(region.texture_id);
 
     glVertexAttribPointer(program->get_position_attribute(), 2, GL_FLOAT, false, 0, vertices);
-    glEnableVertexAttribArray(program->get_position_attribute());
+    gl_state::enable_vertex_attribute(program->get_position_attribute());
 
     glVertexAttribPointer(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 0, tex_coords);
-    glEnableVertexAttribArray(program->get_tex_coordinate_attribute());
+    gl_state::enable_vertex_attribute(program->get_tex_coordinate_attribute());
 
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-
-    glDisableVertexAttribArray(program->get_position_attribute());
-    glDisableVertexAttribArray(program->get_tex_coordinate_attribute());
+    gl_state::draw_arrays(GL_TRIANGLES, 0, 6, CLIENT_VERTEX_BYTES);
 }
 
 bool const Entity::check_collision(Entity* other)
 {
+    frame_stats::current().collision_pairs++;
     float x_distance = fabs(m_position.x - other->m_position.x) - ((m_width + other->m_width) / 2.0f);
     float y_distance = fabs(m_position.y - other->m_position.y) - ((m_height + other->m_height) / 2.0f);
     if (x_distance < 0.0f && y_distance < 0.0f) { m_collided_with = other; }
@@ -178,6 +160,7 @@ void const Entity::check_collision_y(Entity *collidable_entities, int collidable
 
                 // Collision!
                 m_collided_top  = true;
+                game_events::publish({ EVENT_COLLISION, this, collidable_entity, SIDE_TOP });
             } else if (m_velocity.y < 0)
             {
                 m_position.y      += y_overlap;
@@ -185,6 +168,7 @@ void const Entity::check_collision_y(Entity *collidable_entities, int collidable
 
                 // Collision!
                 m_collided_bottom  = true;
+                game_events::publish({ EVENT_COLLISION, this, collidable_entity, SIDE_BOTTOM });
             }
         }
     }
@@ -207,6 +191,7 @@ void const Entity::check_collision_x(Entity *collidable_entities, int collidable
 
                 // Collision!
                 m_collided_right  = true;
+                game_events::publish({ EVENT_COLLISION, this, collidable_entity, SIDE_RIGHT });
                 
             } else if (m_velocity.x < 0)
             {
@@ -215,6 +200,7 @@ void const Entity::check_collision_x(Entity *collidable_entities, int collidable
  
                 // Collision!
                 m_collided_left  = true;
+                game_events::publish({ EVENT_COLLISION, this, collidable_entity, SIDE_LEFT });
             }
         }
     }
@@ -302,82 +288,149 @@ void const Entity::check_collision_x(Map *map)
 }
 
 
-void Entity::update(float delta_time, Entity *player, Entity *collidable_entities, int collidable_entity_count, Map *map)
+void const Entity::snap_to_ground(Map *map)
+{
+    float penetration_x = 0;
+    float penetration_y = 0;
+    
+    // One probe under the feet instead of three below and three above
+    glm::vec3 feet = glm::vec3(m_position.x, m_position.y - (m_height / 2), m_position.z);
+    if (m_velocity.y <= 0 && map->is_solid(feet, &penetration_x, &penetration_y))
+    {
+        m_position.y += penetration_y;
+        m_velocity.y = 0;
+        m_collided_bottom = true;
+    }
+    
+    // And one on the side it is walking towards, so it still stops at walls
+    if (m_velocity.x == 0) return;
+    
+    float direction = m_velocity.x < 0 ? -1.0f : 1.0f;
+    glm::vec3 ahead = glm::vec3(m_position.x + direction * (m_width / 2), m_position.y, m_position.z);
+    if (map->is_solid(ahead, &penetration_x, &penetration_y))
+    {
+        m_position.x -= direction * penetration_x;
+        m_velocity.x = 0;
+        if (direction < 0) m_collided_left  = true;
+        else               m_collided_right = true;
+    }
+}
+
+void Entity::update(float delta_time, Entity *collidable_entities, int collidable_entity_count, Map *map)
 {
     if (!m_is_active) return;
+    
+    m_previous_position = m_position;
+    
+    // Not this entity's step; it stays put until the next due one catches it up
+    if (!m_update_due) return;
+    
+    if (m_is_sleeping)
+    {
+        frame_stats::current().entities_sleeping++;
+        return;
+    }
+    delta_time *= m_update_interval;
+    
+    PROFILE_ZONE("Entity::update");
+    frame_stats::current().entities_updated++;
  
     m_collided_top    = false;
     m_collided_bottom = false;
     m_collided_left   = false;
     m_collided_right  = false;
     
-    if (m_entity_type == ENEMY) ai_activate(player);
-    
-    if (m_animation_indices != NULL)
-    {
-        if (glm::length(m_movement) != 0)
-        {
-            m_animation_time += delta_time;
-            float frames_per_second = (float) 1 / SECONDS_PER_FRAME;
-            
-            if (m_animation_time >= frames_per_second)
-            {
-                m_animation_time = 0.0f;
-                m_animation_index++;
-                
-                if (m_animation_index >= m_animation_frames)
-                {
-                    m_animation_index = 0;
-                }
-            }
-        }
-    }
+    if (m_entity_type == ENEMY && !m_has_external_ai) ai_activate();
     
     m_velocity.x = m_movement.x * m_speed;
     m_velocity += m_acceleration * delta_time;
     
-    m_position.y += m_velocity.y * delta_time;
-    check_collision_y(collidable_entities, collidable_entity_count);
-    check_collision_y(map);
-    
-    m_position.x += m_velocity.x * delta_time;
-    check_collision_x(collidable_entities, collidable_entity_count);
-    check_collision_x(map);
+    if (m_update_interval > 1)
+    {
+        m_position += m_velocity * delta_time;
+        snap_to_ground(map);
+    }
+    else
+    {
+        PROFILE_ZONE("Entity collision");
+        
+        m_position.y += m_velocity.y * delta_time;
+        check_collision_y(collidable_entities, collidable_entity_count);
+        check_collision_y(map);
+        
+        m_position.x += m_velocity.x * delta_time;
+        check_collision_x(collidable_entities, collidable_entity_count);
+        check_collision_x(map);
+    }
     
     if (m_is_jumping)
     {
         m_is_jumping = false;
         m_velocity.y += m_jumping_power;
+        game_events::publish({ EVENT_JUMP, this });
     }
     
-    m_model_matrix = glm::mat4(1.0f);
-    m_model_matrix = glm::translate(m_model_matrix, m_position);
-    m_model_matrix = glm::scale(m_model_matrix, m_sprite_size);
+    // Standing on something with nothing to do; once that has lasted long
+    // enough there is nothing left to integrate until something wakes it
+    bool resting = m_collided_bottom && m_movement == glm::vec3(0.0f) && m_velocity == glm::vec3(0.0f);
+    if (m_entity_type == ENEMY && resting)
+    {
+        if (++m_resting_updates >= SLEEP_AFTER_UPDATES) m_is_sleeping = true;
+    }
+    else
+    {
+        m_resting_updates = 0;
+    }
+}
+
+
+SpriteInstance const Entity::get_sprite_instance() const
+{
+    SpriteInstance sprite;
+    sprite.region            = m_region;
+    sprite.previous_position = m_previous_position;
+    sprite.position          = m_position;
+    sprite.sprite_size       = m_sprite_size;
+    sprite.animator          = m_animator;
+    return sprite;
 }
 
+void Entity::render(ShaderProgram* program, float alpha)
+{
+    render_sprite(program, get_sprite_instance(), alpha);
+}
 
-void Entity::render(ShaderProgram* program)
+void Entity::render_sprite(ShaderProgram* program, const SpriteInstance &sprite, float alpha)
 {
-    program->set_model_matrix(m_model_matrix);
+    PROFILE_ZONE("Entity::render");
+    
+    // alpha is how far the clock is into the next fixed step, so drawing between
+    // the last two simulated positions keeps motion smooth at any simulation rate
+    glm::mat4 model_matrix = glm::mat4(1.0f);
+    model_matrix = glm::translate(model_matrix, sprite.interpolated_position(alpha));
+    model_matrix = glm::scale(model_matrix, sprite.sprite_size);
+    
+    gl_state::use_program(program->get_program_id());
+    program->set_model_matrix(model_matrix);
 
-    if (m_animation_indices != NULL)
+    if (sprite.animation_frame >= 0)
     {
-        draw_sprite_from_texture_atlas(program, m_texture_id, m_animation_indices[m_animation_index]);
+        draw_sprite_from_texture_atlas(program, sprite);
         return;
     }
 
+    const AtlasRegion &region = sprite.region;
     float vertices[] = { -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, -0.5, 0.5, 0.5, -0.5, 0.5 };
-    float tex_coords[] = { 0.0,  1.0, 1.0,  1.0, 1.0, 0.0,  0.0,  1.0, 1.0, 0.0,  0.0, 0.0 };
+    float left = region.u(0.0f), right  = region.u(1.0f),
+          top  = region.v(0.0f), bottom = region.v(1.0f);
+    float tex_coords[] = { left, bottom, right, bottom, right, top, left, bottom, right, top, left, top };
 
-    glBindTexture(GL_TEXTURE_2D, m_texture_id);
+    gl_state::bind_texture(region.texture_id);
 
     glVertexAttribPointer(program->get_position_attribute(), 2, GL_FLOAT, false, 0, vertices);
-    glEnableVertexAttribArray(program->get_position_attribute());
+    gl_state::enable_vertex_attribute(program->get_position_attribute());
     glVertexAttribPointer(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 0, tex_coords);
-    glEnableVertexAttribArray(program->get_tex_coordinate_attribute());
-
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    gl_state::enable_vertex_attribute(program->get_tex_coordinate_attribute());
 
-    glDisableVertexAttribArray(program->get_position_attribute());
-    glDisableVertexAttribArray(program->get_tex_coordinate_attribute());
+    gl_state::draw_arrays(GL_TRIANGLES, 0, 6, CLIENT_VERTEX_BYTES);
 }
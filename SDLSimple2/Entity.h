@@ -2,14 +2,33 @@
 #define ENTITY_H
 
 #include "Map.h"
+#include "Perception.h"
 #include "glm/glm.hpp"
 #include "ShaderProgram.h"
+#include "TextureAtlas.h"
 enum EntityType { PLATFORM, PLAYER, ENEMY  };
 enum AIType     { WALKER, GUARD, JUMPER};
 enum AIState    { WALKING, IDLE, ATTACKING };
 
+// What the AI files and spawn tables call each AIType, indexed by AIType
+inline const char* const AI_TYPE_NAMES[] = { "walker", "guard", "jumper" };
 
-enum AnimationDirection { LEFT, RIGHT, UP, DOWN };
+
+// A copy of what it takes to draw an entity, so it can be drawn (e.g. on the
+// render thread) without touching the entity while it is being updated
+struct SpriteInstance
+{
+    AtlasRegion region;
+    glm::vec3   previous_position; // Where the last fixed step started
+    glm::vec3   position;
+    glm::vec3   sprite_size;
+    int         animation_cols  = 0,
+                animation_rows  = 0,
+                animation_frame = -1; // -1 draws the whole region instead of one frame
+    int         animator        = 0;  // Where AnimationSystem::write_frames() gets the three above
+
+    glm::vec3 const interpolated_position(float alpha) const { return glm::mix(previous_position, position, alpha); }
+};
 
 class Entity
 {
@@ -20,9 +39,22 @@ private:
     bool m_walk_left = true; // For Walker AI only
     
     bool m_is_active = true;
+    bool m_has_external_ai = false; // Driven by BehaviourTrees or UtilityAi instead of ai_activate
+    int  m_agent_slot = -1;         // Its slot in that system's AgentGroups, so leaving it is O(1)
     
-    int m_walking[4][4]; // 4x4 array for walking animations
-
+    // Level of detail, set each step by the scheduler in GameState.cpp. Entities
+    // with an interval above 1 are only updated on due steps, covering the
+    // whole interval in one go and with ground snapping instead of full collision.
+    int  m_update_interval = 1;
+    bool m_update_due      = true;
+    
+    // Enemies that have sat still on the ground for SLEEP_AFTER_UPDATES updates
+    // in a row are skipped entirely until something calls wake()
+    int  m_resting_updates = 0;
+    bool m_is_sleeping     = false;
+    
+    // What the AI decides on, refreshed by Perception rather than read off the player
+    Percept m_percept;
     
     EntityType m_entity_type;
     AIType     m_ai_type;
@@ -30,28 +62,21 @@ private:
     // ————— TRANSFORMATIONS ————— //
     glm::vec3 m_movement;
     glm::vec3 m_position;
+    glm::vec3 m_previous_position = glm::vec3(0.0f); // Where the last fixed step started, for interpolation
     glm::vec3 m_scale;
     glm::vec3 m_velocity;
     glm::vec3 m_acceleration;
 
-    glm::mat4 m_model_matrix;
-
     float     m_speed,
               m_jumping_power;
     
-    bool m_is_jumping;
+    bool m_is_jumping = false;
 
     // ————— TEXTURES ————— //
-    GLuint    m_texture_id;
+    AtlasRegion m_region;
 
     // ————— ANIMATION ————— //
-    int m_animation_cols;
-    int m_animation_frames,
-        m_animation_index,
-        m_animation_rows;
-
-    int* m_animation_indices = nullptr;
-    float m_animation_time = 0.0f;
+    int m_animator = 0; // Slot in the AnimationSystem; 0 never animates
 
     float m_width = 1.0f,
           m_height = 1.0f;
@@ -68,18 +93,15 @@ public:
         m_sprite_size = dimensions;
     }
     // ————— STATIC VARIABLES ————— //
-    static constexpr int SECONDS_PER_FRAME = 4;
+    static constexpr int SLEEP_AFTER_UPDATES = 30;
 
     // ————— METHODS ————— //
     Entity();
-    Entity(GLuint texture_id, float speed, glm::vec3 acceleration, float jump_power, int walking[4][4], float animation_time,
-        int animation_frames, int animation_index, int animation_cols,
-           int animation_rows, float width, float height, EntityType EntityType);
-    Entity(GLuint texture_id, float speed, float width, float height, EntityType EntityType); // Simpler constructor
-    Entity(GLuint texture_id, float speed, float width, float height, EntityType EntityType, AIType AIType, AIState AIState); // AI constructor
+    Entity(AtlasRegion region, float speed, float width, float height, EntityType EntityType); // Simpler constructor
+    Entity(AtlasRegion region, float speed, float width, float height, EntityType EntityType, AIType AIType, AIState AIState); // AI constructor
     ~Entity();
 
-    void draw_sprite_from_texture_atlas(ShaderProgram* program, GLuint texture_id, int index);
+    static void draw_sprite_from_texture_atlas(ShaderProgram* program, const SpriteInstance &sprite);
     bool const check_collision(Entity* other);
     
     void const check_collision_y(Entity* collidable_entities, int collidable_entity_count);
@@ -89,27 +111,27 @@ public:
     void const check_collision_y(Map *map);
     void const check_collision_x(Map *map);
     
-    void update(float delta_time, Entity *player, Entity *collidable_entities, int collidable_entity_count, Map *map);
-    void render(ShaderProgram* program);
+    // Cheap stand-in for both map checks above, for entities far from the view
+    void const snap_to_ground(Map *map);
+    
+    void update(float delta_time, Entity *collidable_entities, int collidable_entity_count, Map *map);
+    void render(ShaderProgram* program, float alpha = 1.0f);
+    static void render_sprite(ShaderProgram* program, const SpriteInstance &sprite, float alpha);
 
-    void ai_activate(Entity *player);
+    void ai_activate();
     void ai_walk();
-    void ai_guard(Entity *player);
+    void ai_guard();
     void ai_jump();
     
     void normalise_movement() { m_movement = glm::normalize(m_movement); }
 
-    void face_left() { m_animation_indices = m_walking[LEFT]; }
-    void face_right() { m_animation_indices = m_walking[RIGHT]; }
-    void face_up() { m_animation_indices = m_walking[UP]; }
-    void face_down() { m_animation_indices = m_walking[DOWN]; }
-
-    void move_left() { m_movement.x = -1.0f;  } // face_left()
+    void move_left() { m_movement.x = -1.0f;  }
     void move_right() { m_movement.x = 1.0f;   }
     void move_up() { m_movement.y = 1.0f;   }
     void move_down() { m_movement.y = -1.0f;  }
     
-    void const jump() { m_is_jumping = true; }
+    void const jump() { m_is_jumping = true; wake(); }
+    void const wake() { m_is_sleeping = false; m_resting_updates = 0; }
 
     // ————— GETTERS ————— //
     EntityType const get_entity_type()    const { return m_entity_type;   };
@@ -120,47 +142,50 @@ public:
     glm::vec3 const get_acceleration() const { return m_acceleration; }
     glm::vec3 const get_movement()     const { return m_movement; }
     glm::vec3 const get_scale()        const { return m_scale; }
-    GLuint    const get_texture_id()   const { return m_texture_id; }
+    GLuint    const get_texture_id()   const { return m_region.texture_id; }
+    AtlasRegion const get_region()     const { return m_region; }
     float     const get_speed()        const { return m_speed; }
+    float     const get_jumping_power() const { return m_jumping_power; }
+    float     const get_width()        const { return m_width; }
+    float     const get_height()       const { return m_height; }
     bool      const get_collided_top() const { return m_collided_top; }
     bool      const get_collided_bottom() const { return m_collided_bottom; }
     bool      const get_collided_right() const { return m_collided_right; }
     bool      const get_collided_left() const { return m_collided_left; }
     Entity* const get_collided_with() const { return m_collided_with; }
+    SpriteInstance const get_sprite_instance() const;
     bool get_is_active() const { return m_is_active; }
+    bool get_has_external_ai() const { return m_has_external_ai; }
+    bool get_is_sleeping()     const { return m_is_sleeping; }
+    int  const get_animator()        const { return m_animator; }
+    int  const get_agent_slot()      const { return m_agent_slot; }
+    int  const get_update_interval() const { return m_update_interval; }
+    bool const get_update_due()      const { return m_update_due; }
+    const Percept &get_percept()     const { return m_percept; }
     void activate()   { m_is_active = true;  };
     void deactivate() { m_is_active = false; };
     // ————— SETTERS ————— //
     void const set_entity_type(EntityType new_entity_type)  { m_entity_type = new_entity_type;};
     void const set_ai_type(AIType new_ai_type){ m_ai_type = new_ai_type;};
-    void const set_ai_state(AIState new_state){ m_ai_state = new_state;};
-    void const set_position(glm::vec3 new_position) { m_position = new_position; }
-    void const set_velocity(glm::vec3 new_velocity) { m_velocity = new_velocity; }
-    void const set_acceleration(glm::vec3 new_acceleration) { m_acceleration = new_acceleration; }
-    void const set_movement(glm::vec3 new_movement) { m_movement = new_movement; }
+    void const set_ai_state(AIState new_state){ if (new_state != m_ai_state) wake(); m_ai_state = new_state;};
+    void const set_has_external_ai(bool has_external_ai) { m_has_external_ai = has_external_ai; }
+    void const set_update_lod(int interval, bool due) { m_update_interval = interval; m_update_due = due; }
+    void const set_percept(const Percept &new_percept) { m_percept = new_percept; }
+    void const set_can_see_player(bool can_see_player) { m_percept.can_see_player = can_see_player; }
+    void const set_position(glm::vec3 new_position) { m_position = new_position; m_previous_position = new_position; wake(); } // Teleports, no interpolation
+    void const nudge(glm::vec3 offset) { m_position += offset; if (offset != glm::vec3(0.0f)) wake(); } // Moves it this step, still interpolated
+    void const set_velocity(glm::vec3 new_velocity) { m_velocity = new_velocity; if (new_velocity != glm::vec3(0.0f)) wake(); }
+    void const set_acceleration(glm::vec3 new_acceleration) { m_acceleration = new_acceleration; wake(); }
+    void const set_movement(glm::vec3 new_movement) { m_movement = new_movement; if (new_movement != glm::vec3(0.0f)) wake(); }
     void const set_scale(glm::vec3 new_scale) { m_scale = new_scale; }
-    void const set_texture_id(GLuint new_texture_id) { m_texture_id = new_texture_id; }
+    void const set_texture_id(GLuint new_texture_id) { m_region = AtlasRegion(new_texture_id); }
+    void const set_region(AtlasRegion new_region) { m_region = new_region; }
     void const set_speed(float new_speed) { m_speed = new_speed; }
-    void const set_animation_cols(int new_cols) { m_animation_cols = new_cols; }
-    void const set_animation_rows(int new_rows) { m_animation_rows = new_rows; }
-    void const set_animation_frames(int new_frames) { m_animation_frames = new_frames; }
-    void const set_animation_index(int new_index) { m_animation_index = new_index; }
-    void const set_animation_time(float new_time) { m_animation_time = new_time; }
+    void const set_animator(int new_animator) { m_animator = new_animator; }
+    void const set_agent_slot(int new_agent_slot) { m_agent_slot = new_agent_slot; }
     void const set_jumping_power(float new_jumping_power) { m_jumping_power = new_jumping_power;}
     void const set_width(float new_width) {m_width = new_width; }
     void const set_height(float new_height) {m_height = new_height; }
-
-    // Setter for m_walking
-    void set_walking(int walking[4][4])
-    {
-        for (int i = 0; i < 4; ++i)
-        {
-            for (int j = 0; j < 4; ++j)
-            {
-                m_walking[i][j] = walking[i][j];
-            }
-        }
-    }
 };
 
 #endif // ENTITY_H
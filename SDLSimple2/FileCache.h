@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Keys and paths for the on-disk caches (compiled shaders, navigation graphs).
+// A cache file is named after the key of whatever it was made from, so one
+// that no longer matches simply misses and is made again.
+namespace file_cache
+{
+    constexpr uint64_t HASH_SEED = 14695981039346656037ull;
+
+    // FNV-1a; only used for cache keys, so it just needs to be cheap and stable.
+    // Chain calls by passing the previous hash in.
+    inline uint64_t hash_bytes(const void* bytes, size_t size, uint64_t hash = HASH_SEED)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= ((const unsigned char*) bytes)[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    inline uint64_t hash_bytes(const std::string &bytes, uint64_t hash = HASH_SEED)
+    {
+        return hash_bytes(bytes.data(), bytes.size(), hash);
+    }
+
+    // e.g. "shader_cache/0123456789abcdef.bin"
+    inline std::string filepath(const char* directory, uint64_t key, const char* extension)
+    {
+        char name[40];
+        snprintf(name, sizeof(name), "%016llx.%s", (unsigned long long) key, extension);
+        return std::string(directory) + "/" + name;
+    }
+}
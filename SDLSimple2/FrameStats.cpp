@@ -0,0 +1,138 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include "FrameStats.h"
+#include "GLState.h"
+
+// Rows are buffered by stdio and pushed to disk this often, so a crash loses at most this many
+constexpr int CSV_FLUSH_FRAMES = 60;
+
+static FrameStats s_last_frame;
+static uint64_t   s_frame_index = 0;
+static std::chrono::steady_clock::time_point s_frame_start;
+
+static std::atomic<uint64_t> s_allocations(0);
+static uint64_t              s_allocations_at_frame_start = 0;
+
+static FILE* s_csv_file = nullptr;
+
+// Simulation counters flushed by other threads since the last end_frame()
+static std::mutex s_flushed_mutex;
+static FrameStats s_flushed;
+
+static void add_simulation_counters(FrameStats &into, const FrameStats &from)
+{
+    into.substeps          += from.substeps;
+    into.substeps_dropped  += from.substeps_dropped;
+    into.entities_updated  += from.entities_updated;
+    into.entities_sleeping += from.entities_sleeping;
+    into.collision_pairs   += from.collision_pairs;
+    into.tiles_probed      += from.tiles_probed;
+    into.ai_decisions      += from.ai_decisions;
+}
+
+void frame_stats::begin_frame()
+{
+    g_current = FrameStats();
+    g_current.frame_index = s_frame_index++;
+    s_frame_start = std::chrono::steady_clock::now();
+    s_allocations_at_frame_start = s_allocations.load(std::memory_order_relaxed);
+}
+
+void frame_stats::flush_thread()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_flushed_mutex);
+        add_simulation_counters(s_flushed, g_current);
+    }
+    g_current = FrameStats();
+}
+
+void frame_stats::end_frame()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_flushed_mutex);
+        add_simulation_counters(g_current, s_flushed);
+        s_flushed = FrameStats();
+    }
+
+    // gl_state resets its counters when the frame's rendering starts
+    GLStateCounters counters = gl_state::get_frame_counters();
+    g_current.draw_calls     = counters.draw_calls;
+    g_current.vertices       = counters.vertices;
+    g_current.texture_binds  = counters.texture_binds;
+    g_current.bytes_uploaded = counters.bytes_uploaded;
+
+    g_current.allocations = s_allocations.load(std::memory_order_relaxed) - s_allocations_at_frame_start;
+    g_current.frame_ms    = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - s_frame_start).count();
+
+    s_last_frame = g_current;
+
+    if (s_csv_file == nullptr) return;
+
+    const FrameStats &stats = s_last_frame;
+    fprintf(s_csv_file, "%llu,%.3f,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%zu,%llu\n",
+            (unsigned long long) stats.frame_index, stats.frame_ms,
+            stats.substeps, stats.substeps_dropped, stats.entities_updated, stats.entities_sleeping, stats.collision_pairs, stats.tiles_probed, stats.ai_decisions,
+            stats.draw_calls, stats.vertices, stats.texture_binds, stats.bytes_uploaded,
+            (unsigned long long) stats.allocations);
+
+    if (stats.frame_index % CSV_FLUSH_FRAMES == 0) fflush(s_csv_file);
+}
+
+FrameStats const &frame_stats::get_last_frame()
+{
+    return s_last_frame;
+}
+
+bool frame_stats::start_csv(const char* filepath)
+{
+    stop_csv();
+
+    s_csv_file = fopen(filepath, "w");
+    if (s_csv_file == nullptr) return false;
+
+    fprintf(s_csv_file, "frame,frame_ms,substeps,substeps_dropped,entities_updated,entities_sleeping,collision_pairs,tiles_probed,ai_decisions,"
+                        "draw_calls,vertices,texture_binds,bytes_uploaded,allocations\n");
+    return true;
+}
+
+void frame_stats::stop_csv()
+{
+    if (s_csv_file == nullptr) return;
+
+    fclose(s_csv_file);
+    s_csv_file = nullptr;
+}
+
+bool const frame_stats::is_writing_csv()
+{
+    return s_csv_file != nullptr;
+}
+
+#if COUNT_ALLOCATIONS
+// Replacing the global allocation functions is the only way to see every
+// allocation, including the ones inside the standard library. The array and
+// nothrow forms forward to these by default; over-aligned ones go uncounted.
+void* operator new(std::size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+
+    void* pointer = std::malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Set to 0 (e.g. -DCOUNT_ALLOCATIONS=0) to leave the global operator new alone
+#ifndef COUNT_ALLOCATIONS
+#define COUNT_ALLOCATIONS 1
+#endif
+
+// What one frame did. Simulation counters are bumped directly by the code doing
+// the work; the GL and allocation figures are filled in by end_frame().
+struct FrameStats
+{
+    uint64_t frame_index       = 0;
+    double   frame_ms          = 0.0;
+
+    // ————— SIMULATION ————— //
+    int      substeps          = 0; // Fixed steps run by update()
+    int      substeps_dropped  = 0; // Steps skipped because they were over the substep budget
+    int      entities_updated  = 0; // Active entities stepped, summed over substeps
+    int      entities_sleeping = 0; // Active entities skipped because they were asleep, summed the same way
+    int      collision_pairs   = 0; // Entity-vs-entity overlap tests
+    int      tiles_probed      = 0; // Map::is_solid calls
+    int      ai_decisions      = 0; // AI behaviours evaluated
+
+    // ————— RENDERING ————— //
+    int      draw_calls        = 0;
+    int      vertices          = 0;
+    int      texture_binds     = 0;
+    size_t   bytes_uploaded    = 0;
+
+    // ————— MEMORY ————— //
+    uint64_t allocations       = 0; // operator new calls on any thread
+};
+
+// Each thread counts into its own current() without synchronisation. Threads
+// other than the one running the frame loop hand their simulation counters
+// over with flush_thread(); end_frame() folds them into the frame. Finished
+// frames are kept in get_last_frame() and, while a CSV dump is open, appended
+// to it and flushed every few frames.
+namespace frame_stats
+{
+    // Defined here so the increments in hot loops (Map::is_solid) stay inline
+    inline thread_local FrameStats g_current;
+    inline FrameStats &current() { return g_current; }
+
+    void begin_frame();
+    void end_frame();
+    void flush_thread();
+
+    FrameStats const &get_last_frame();
+
+    bool start_csv(const char* filepath);
+    void stop_csv();
+    bool const is_writing_csv();
+}
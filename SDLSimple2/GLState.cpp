@@ -0,0 +1,173 @@
+#include <cstdio>
+#include <unordered_map>
+#include "GLState.h"
+
+// Sentinel meaning "unknown"; forces the next call through to GL
+constexpr GLuint UNKNOWN_BINDING = 0xFFFFFFFFu;
+constexpr int    MAX_TRACKED_ATTRIBUTES = 32;
+
+static GLuint   s_program_id = 0;
+static GLuint   s_texture_id = 0;
+static uint32_t s_enabled_attributes = 0;
+static uint32_t s_known_attributes   = ~0u; // Fresh contexts start with every attribute disabled
+
+static std::unordered_map<uint64_t, glm::mat4> s_matrix_uniforms;
+static std::unordered_map<uint64_t, glm::vec4> s_vec4_uniforms;
+
+static GLStateCounters s_counters;
+
+// Parsed from GL_VERSION on first use; -1 until then
+static int s_version_major = -1;
+static int s_version_minor = 0;
+
+static uint64_t uniform_key(GLuint program_id, GLint location)
+{
+    return ((uint64_t) program_id << 32) | (uint32_t) location;
+}
+
+void gl_state::use_program(GLuint program_id)
+{
+    if (s_program_id == program_id)
+    {
+        s_counters.elided++;
+        return;
+    }
+
+    glUseProgram(program_id);
+    s_program_id = program_id;
+    s_counters.issued++;
+}
+
+void gl_state::bind_texture(GLuint texture_id)
+{
+    if (s_texture_id == texture_id)
+    {
+        s_counters.elided++;
+        return;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    s_texture_id = texture_id;
+    s_counters.issued++;
+    s_counters.texture_binds++;
+}
+
+void gl_state::enable_vertex_attribute(GLuint index)
+{
+    uint32_t bit = index < MAX_TRACKED_ATTRIBUTES ? (1u << index) : 0;
+
+    if (bit != 0 && (s_known_attributes & bit) && (s_enabled_attributes & bit))
+    {
+        s_counters.elided++;
+        return;
+    }
+
+    glEnableVertexAttribArray(index);
+    s_enabled_attributes |= bit;
+    s_known_attributes   |= bit;
+    s_counters.issued++;
+}
+
+void gl_state::disable_vertex_attribute(GLuint index)
+{
+    uint32_t bit = index < MAX_TRACKED_ATTRIBUTES ? (1u << index) : 0;
+
+    if (bit != 0 && (s_known_attributes & bit) && !(s_enabled_attributes & bit))
+    {
+        s_counters.elided++;
+        return;
+    }
+
+    glDisableVertexAttribArray(index);
+    s_enabled_attributes &= ~bit;
+    s_known_attributes   |= bit;
+    s_counters.issued++;
+}
+
+void gl_state::uniform_matrix4(GLuint program_id, GLint location, const glm::mat4 &matrix)
+{
+    // Location -1 means the uniform was optimised out; GL would ignore it anyway
+    if (location < 0)
+    {
+        s_counters.elided++;
+        return;
+    }
+
+    auto previous = s_matrix_uniforms.find(uniform_key(program_id, location));
+    if (previous != s_matrix_uniforms.end() && previous->second == matrix)
+    {
+        s_counters.elided++;
+        return;
+    }
+
+    use_program(program_id);
+    glUniformMatrix4fv(location, 1, GL_FALSE, &matrix[0][0]);
+    s_matrix_uniforms[uniform_key(program_id, location)] = matrix;
+    s_counters.issued++;
+    s_counters.bytes_uploaded += sizeof(matrix);
+}
+
+void gl_state::uniform_vec4(GLuint program_id, GLint location, const glm::vec4 &value)
+{
+    if (location < 0)
+    {
+        s_counters.elided++;
+        return;
+    }
+
+    auto previous = s_vec4_uniforms.find(uniform_key(program_id, location));
+    if (previous != s_vec4_uniforms.end() && previous->second == value)
+    {
+        s_counters.elided++;
+        return;
+    }
+
+    use_program(program_id);
+    glUniform4f(location, value.x, value.y, value.z, value.w);
+    s_vec4_uniforms[uniform_key(program_id, location)] = value;
+    s_counters.issued++;
+    s_counters.bytes_uploaded += sizeof(value);
+}
+
+void gl_state::draw_arrays(GLenum mode, GLint first, GLsizei count, size_t bytes_per_vertex)
+{
+    glDrawArrays(mode, first, count);
+    s_counters.draw_calls++;
+    s_counters.vertices       += count;
+    s_counters.bytes_uploaded += (size_t) count * bytes_per_vertex;
+}
+
+void gl_state::count_upload(size_t bytes)
+{
+    s_counters.bytes_uploaded += bytes;
+}
+
+void gl_state::invalidate()
+{
+    s_program_id       = UNKNOWN_BINDING;
+    s_texture_id       = UNKNOWN_BINDING;
+    s_known_attributes = 0;
+    s_matrix_uniforms.clear();
+    s_vec4_uniforms.clear();
+}
+
+bool gl_state::gl_version_at_least(int major, int minor)
+{
+    if (s_version_major < 0)
+    {
+        s_version_major = 0;
+        const GLubyte* version = glGetString(GL_VERSION);
+        if (version != nullptr) sscanf((const char*) version, "%d.%d", &s_version_major, &s_version_minor);
+    }
+    return s_version_major > major || (s_version_major == major && s_version_minor >= minor);
+}
+
+void gl_state::begin_frame()
+{
+    s_counters = GLStateCounters();
+}
+
+GLStateCounters const gl_state::get_frame_counters()
+{
+    return s_counters;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <cstddef>
+#include "glm/glm.hpp"
+
+// Every draw streams a vec2 position and a vec2 tex coord from client memory
+constexpr size_t CLIENT_VERTEX_BYTES = 4 * sizeof(float);
+
+struct GLStateCounters
+{
+    int issued = 0; // Calls that reached the driver
+    int elided = 0; // Calls skipped because the state was already set
+
+    int    draw_calls     = 0;
+    int    texture_binds  = 0; // Binds that reached the driver
+    int    vertices       = 0;
+    size_t bytes_uploaded = 0; // Client-side vertices, uniforms, buffer updates and textures
+};
+
+// Shadow copy of the bits of GL state the game touches every draw: the bound
+// program and texture, which vertex attributes are enabled and the last value
+// written to each uniform. Every setter compares against the shadow first and
+// only calls into GL on a change. All of it assumes the thread owning the
+// context; anything that changes state behind its back must call invalidate().
+namespace gl_state
+{
+    void use_program(GLuint program_id);
+    void bind_texture(GLuint texture_id);
+    void enable_vertex_attribute(GLuint index);
+    void disable_vertex_attribute(GLuint index);
+
+    // Uniforms are remembered per program, so switching programs never
+    // causes another program's values to be re-sent
+    void uniform_matrix4(GLuint program_id, GLint location, const glm::mat4 &matrix);
+    void uniform_vec4(GLuint program_id, GLint location, const glm::vec4 &value);
+
+    // Draws through here are counted; bytes_per_vertex is what the driver has
+    // to copy out of client memory for each vertex (0 for buffer-backed data)
+    void draw_arrays(GLenum mode, GLint first, GLsizei count, size_t bytes_per_vertex);
+    void count_upload(size_t bytes);
+
+    void invalidate();
+
+    // Whether the current context is at least GL major.minor, parsed once
+    // from GL_VERSION (so only ask with the context current)
+    bool gl_version_at_least(int major, int minor);
+
+    // Counters cover everything since the last begin_frame()
+    void begin_frame();
+    GLStateCounters const get_frame_counters();
+}
@@ -0,0 +1,51 @@
+#include <algorithm>
+#include <vector>
+#include "GameEvents.h"
+
+static GameEvent             s_events[game_events::EVENT_CAPACITY];
+static std::atomic<uint32_t> s_event_count(0);
+static std::atomic<uint32_t> s_dropped_events(0);
+
+static std::vector<game_events::Listener> s_listeners[EVENT_TYPE_COUNT];
+
+bool game_events::publish(const GameEvent &event)
+{
+    // Claiming a slot is the only shared write; the slot itself belongs to us
+    uint32_t slot = s_event_count.fetch_add(1, std::memory_order_relaxed);
+    if (slot >= EVENT_CAPACITY)
+    {
+        s_dropped_events.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    s_events[slot] = event;
+    return true;
+}
+
+void game_events::subscribe(EventType type, Listener listener)
+{
+    s_listeners[type].push_back(std::move(listener));
+}
+
+void game_events::dispatch()
+{
+    // Re-reading the count each time picks up whatever the listeners publish
+    for (uint32_t i = 0; i < std::min(s_event_count.load(std::memory_order_acquire), EVENT_CAPACITY); i++)
+    {
+        const GameEvent event = s_events[i];
+        for (const Listener &listener : s_listeners[event.type]) listener(event);
+    }
+
+    s_event_count.store(0, std::memory_order_release);
+}
+
+void game_events::reset()
+{
+    for (std::vector<Listener> &listeners : s_listeners) listeners.clear();
+    s_event_count.store(0, std::memory_order_release);
+}
+
+uint32_t const game_events::get_dropped_events()
+{
+    return s_dropped_events.load(std::memory_order_relaxed);
+}
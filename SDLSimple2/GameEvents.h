@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+class Entity;
+
+enum EventType { EVENT_COLLISION, EVENT_DEATH, EVENT_JUMP, EVENT_SOUND, EVENT_TYPE_COUNT };
+enum CollisionSide { SIDE_TOP, SIDE_BOTTOM, SIDE_LEFT, SIDE_RIGHT };
+enum SoundEffect { SOUND_JUMP };
+
+// Something that happened during a step. Which fields mean anything depends on the type:
+//   COLLISION: subject ran into other, touching it with its own side
+//   DEATH:     subject was killed
+//   JUMP:      subject left the ground
+//   SOUND:     play sound (subject, if set, is what made it)
+struct GameEvent
+{
+    EventType     type;
+    Entity*       subject = nullptr;
+    Entity*       other   = nullptr;
+    CollisionSide side    = SIDE_TOP;
+    SoundEffect   sound   = SOUND_JUMP;
+};
+
+// Gameplay events, decoupled from whoever reacts to them. Any number of threads
+// may publish while the simulation runs; publishing is a single atomic add
+// into a fixed array, so it never blocks (events past EVENT_CAPACITY in one
+// step are dropped and counted). dispatch() is the sync point: it must run
+// once every producer is done for the step, and hands each event, in order,
+// to the listeners for its type. Events published by listeners are delivered
+// in the same dispatch.
+namespace game_events
+{
+    constexpr uint32_t EVENT_CAPACITY = 4096;
+
+    using Listener = std::function<void(const GameEvent &event)>;
+
+    bool publish(const GameEvent &event);
+
+    // Listeners are registered up front, not while a step is running
+    void subscribe(EventType type, Listener listener);
+    void dispatch();
+    void reset(); // Drops every listener and pending event
+
+    uint32_t const get_dropped_events();
+}
@@ -0,0 +1,210 @@
+#include "GameState.h"
+#include "GameEvents.h"
+#include "Profiler.h"
+#include "FrameStats.h"
+
+void subscribe_game_rules(GameState &state)
+{
+    GameState* game = &state;
+    
+    // Stimuli go first, before the rules below move anything out of the way
+    game_events::subscribe(EVENT_JUMP, [game](const GameEvent &event)
+    {
+        if (event.subject != game->player) return;
+        game->perception.add_stimulus({ STIMULUS_NOISE, event.subject->get_position(), NOISE_RADIUS, NOISE_DURATION, event.subject });
+    });
+    
+    game_events::subscribe(EVENT_DEATH, [game](const GameEvent &event)
+    {
+        if (event.subject == game->player) return;
+        game->perception.add_stimulus({ STIMULUS_ALLY_DEATH, event.subject->get_position(), ALLY_DEATH_RADIUS, ALLY_DEATH_DURATION, event.subject });
+    });
+    
+    // Landing on an enemy stomps it; running into one side-on ends the round
+    game_events::subscribe(EVENT_COLLISION, [game](const GameEvent &event)
+    {
+        if (event.subject != game->player || event.other->get_entity_type() != ENEMY) return;
+        
+        if (event.side == SIDE_BOTTOM)
+        {
+            game_events::publish({ EVENT_DEATH, event.other });
+        }
+        else if (event.side == SIDE_LEFT || event.side == SIDE_RIGHT)
+        {
+            game_events::publish({ EVENT_DEATH, game->player });
+        }
+    });
+    
+    game_events::subscribe(EVENT_DEATH, [game](const GameEvent &event)
+    {
+        if (event.subject == game->player)
+        {
+            game->lose_game = true;
+            return;
+        }
+        
+        if (game->wave_director != nullptr)
+        {
+            game->wave_director->despawn(*game, event.subject);
+            return;
+        }
+        
+        event.subject->deactivate();
+        
+        // Park it out of the way; inactive entities still count as collidable
+        event.subject->set_position(glm::vec3(-10.0f, -10.0f, 0.0f));
+    });
+    
+    // Whatever happens next to a sleeping enemy may concern it
+    auto wake_nearby = [game](const GameEvent &event)
+    {
+        glm::vec3 position = event.subject->get_position();
+        for (int i = 0; i < game->enemy_count; i++)
+        {
+            Entity &enemy = game->enemies[i];
+            if (enemy.get_is_sleeping() && glm::distance(enemy.get_position(), position) < WAKE_DISTANCE) enemy.wake();
+        }
+    };
+    game_events::subscribe(EVENT_COLLISION, wake_nearby);
+    game_events::subscribe(EVENT_DEATH, wake_nearby);
+    
+    game_events::subscribe(EVENT_JUMP, [game](const GameEvent &event)
+    {
+        if (event.subject == game->player) game_events::publish({ EVENT_SOUND, event.subject, nullptr, SIDE_TOP, SOUND_JUMP });
+    });
+}
+
+void attach_enemy_ai(GameState &state, Entity* enemy)
+{
+    const char* name = AI_TYPE_NAMES[enemy->get_ai_type()];
+    int profile = state.utility_ai      != nullptr ? state.utility_ai->find_profile(name)    : -1;
+    int tree    = state.behaviour_trees != nullptr ? state.behaviour_trees->find_tree(name) : -1;
+    
+    if      (profile >= 0) state.utility_ai->add_agent(profile, enemy);
+    else if (tree >= 0)    state.behaviour_trees->add_agent(tree, enemy);
+}
+
+void detach_enemy_ai(GameState &state, Entity* enemy)
+{
+    if (state.utility_ai      != nullptr && state.utility_ai->remove_agent(enemy)) return;
+    if (state.behaviour_trees != nullptr) state.behaviour_trees->remove_agent(enemy);
+}
+
+void attach_enemy_animator(GameState &state, Entity* enemy)
+{
+    int set = state.animation != nullptr ? state.animation->find_set(AI_TYPE_NAMES[enemy->get_ai_type()]) : -1;
+    if (set >= 0) enemy->set_animator(state.animation->add_animator(set));
+}
+
+void detach_enemy_animator(GameState &state, Entity* enemy)
+{
+    if (state.animation != nullptr) state.animation->remove_animator(enemy->get_animator());
+    enemy->set_animator(0);
+}
+
+// Whether a changed tile is under, beside or inside the entity
+static bool touches_changed_tile(const Entity &entity, const Map &map)
+{
+    glm::vec3 position = entity.get_position();
+    float tile_size = map.get_tile_size();
+    
+    for (const glm::ivec2 &tile : map.get_changed_tiles())
+    {
+        glm::vec2 offset = glm::abs(glm::vec2(position) - glm::vec2(tile.x * tile_size, -tile.y * tile_size));
+        if (offset.x < tile_size * 1.5f && offset.y < tile_size * 1.5f) return true;
+    }
+    return false;
+}
+
+// Enemies in or near the view run every step. The rest run one step in
+// LOD_FAR_INTERVAL, covering the whole interval at once, staggered by index
+// so only about a quarter of them land on any one step. Sleeping enemies are
+// woken here when the player comes close or the ground under them changes,
+// and the navigation graph catches up with those changes (over as many
+// steps as its budget needs).
+static void schedule_enemy_updates(GameState &state)
+{
+    PROFILE_ZONE("schedule enemy updates");
+    
+    // Where the camera in main.cpp will be looking
+    glm::vec3 player_position = state.player->get_position();
+    glm::vec3 view_centre = glm::vec3(player_position.x, 0.0f, 0.0f);
+    bool tiles_changed = !state.map->get_changed_tiles().empty();
+    
+    for (int i = 0; i < state.enemy_count; i++)
+    {
+        Entity &enemy = state.enemies[i];
+        glm::vec3 offset = glm::abs(enemy.get_position() - view_centre);
+        
+        if (enemy.get_is_sleeping())
+        {
+            bool player_near = glm::distance(enemy.get_position(), player_position) < WAKE_DISTANCE;
+            if (player_near || (tiles_changed && touches_changed_tile(enemy, *state.map))) enemy.wake();
+        }
+        
+        if (!state.update_lod || (offset.x < LOD_NEAR_HALF_WIDTH && offset.y < LOD_NEAR_HALF_HEIGHT))
+        {
+            enemy.set_update_lod(1, true);
+        }
+        else
+        {
+            enemy.set_update_lod(LOD_FAR_INTERVAL, (state.step_count + i) % LOD_FAR_INTERVAL == 0);
+        }
+    }
+    if (state.nav_graph  != nullptr && tiles_changed) state.nav_graph->update_tiles(state.map->get_changed_tiles());
+    if (state.nav_graph  != nullptr) state.nav_graph->update();
+    
+    state.map->clear_changed_tiles();
+    state.step_count++;
+}
+
+void step_game_state(GameState &state, float delta_time)
+{
+    PROFILE_ZONE("update substep");
+    frame_stats::current().substeps++;
+    
+    // First, so whatever spawns is scheduled and decides along with everyone else
+    if (state.wave_director != nullptr) state.wave_director->update(state, delta_time);
+    
+    schedule_enemy_updates(state);
+    
+//    state.player->update(delta_time, state.platforms, PLATFORM_COUNT, state.map);
+    state.player->update(delta_time, state.enemies, state.enemy_count, state.map);
+    
+    // Refreshed before anyone decides, with the player where they ended up
+    state.perception.add_stimulus({ STIMULUS_PLAYER, state.player->get_position(), PERCEPTION_RANGE, 0.0f, state.player });
+    state.perception.update(delta_time, state.enemies, state.enemy_count, state.map, state.step_count);
+    
+    // Decided on last step's collisions, before anyone moves
+    if (state.behaviour_trees != nullptr) state.behaviour_trees->tick(delta_time);
+    if (state.utility_ai      != nullptr) state.utility_ai->tick();
+    
+    for (int i = 0; i < state.enemy_count; i++) {
+
+            state.enemies[i].update(delta_time,
+                                    state.player,
+                                    1,
+                                    state.map
+                                    );
+            
+        if (state.enemies[i].get_ai_type() == JUMPER && !state.enemies[i].get_has_external_ai() && state.enemies[i].get_update_due()) {
+            state.enemies[i].ai_jump();
+        }
+    }
+    
+    // After everyone has moved, and before the player collides with where they ended up
+    state.crowd.separate(state.enemies, state.enemy_count, state.map);
+    
+    // Enemies that walked into the player this step; what happens next is up to
+    // whoever listens for the collision events this publishes
+    {
+        PROFILE_ZONE("player vs enemy collision");
+        state.player->check_collision_x(state.enemies, state.enemy_count);
+        state.player->check_collision_y(state.enemies, state.enemy_count);
+    }
+    
+    {
+        PROFILE_ZONE("dispatch events");
+        game_events::dispatch();
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <SDL_mixer.h>
+#include "Entity.h"
+#include "Map.h"
+#include "BehaviourTrees.h"
+#include "UtilityAi.h"
+#include "Perception.h"
+#include "Crowd.h"
+#include "NavGraph.h"
+#include "WaveDirector.h"
+#include "AnimationSystem.h"
+
+// Enemies outside this box around the view centre are only updated every
+// LOD_FAR_INTERVAL steps. The view is the ortho projection in main.cpp (10 by
+// 7.5 units, following the player's x) plus a couple of units of margin, so
+// nothing on screen ever runs at the reduced rate.
+constexpr float LOD_NEAR_HALF_WIDTH  = 7.0f,
+                LOD_NEAR_HALF_HEIGHT = 5.75f;
+constexpr int   LOD_FAR_INTERVAL     = 4;
+
+// Sleeping enemies this close to the player, or to a collision or death, wake
+// up. Comfortably more than any distance the AI reacts at (guards react at 3).
+constexpr float WAKE_DISTANCE = 6.0f;
+
+// How far and for how long (in seconds) the stimuli raised by the rules carry
+constexpr float NOISE_RADIUS        = 6.0f,
+                NOISE_DURATION      = 2.0f,
+                ALLY_DEATH_RADIUS   = 8.0f,
+                ALLY_DEATH_DURATION = 3.0f;
+
+struct GameState
+{
+    Entity *player;
+//    Entity *platforms;
+    Entity *enemies;
+    int     enemy_count = 0;
+    
+    Map* map;
+    BehaviourTrees* behaviour_trees = nullptr; // Enemies in neither of these use ai_activate
+    UtilityAi*      utility_ai      = nullptr;
+    Perception      perception;                // What every enemy's AI decides on
+    Crowd           crowd;                     // Keeps enemies from standing inside each other
+    NavGraph*       nav_graph       = nullptr; // Kept up to date with the map's changed tiles
+    WaveDirector*   wave_director   = nullptr; // Owns the enemies when set, and takes back the dead ones
+    AnimationSystem* animation       = nullptr; // Enemies without an animator draw their whole region
+    
+    Mix_Music *bgm;
+    Mix_Chunk *jump_sfx;
+    
+    bool lose_game = false;
+    
+    bool         update_lod = true; // false updates every enemy every step
+    unsigned int step_count = 0;    // Fixed steps taken, for staggering far updates
+};
+
+// Registers the rules (stomping, losing, jump sounds, the stimuli enemies
+// perceive) as game_events listeners.
+// Call once per GameState, after game_events::reset() if replacing another.
+void subscribe_game_rules(GameState &state);
+
+// Hands an enemy to the utility profile for its AIType if there is one, else
+// its behaviour tree, else leaves it on ai_activate; and takes it back
+void attach_enemy_ai(GameState &state, Entity* enemy);
+void detach_enemy_ai(GameState &state, Entity* enemy);
+
+// Gives an enemy an animator playing the animation set named after its AIType,
+// if there is one; and frees it again
+void attach_enemy_animator(GameState &state, Entity* enemy);
+void detach_enemy_animator(GameState &state, Entity* enemy);
+
+// Advances the player and every enemy by one fixed step, then dispatches the
+// events it raised. Touches no SDL or GL state, so it can be driven headless
+// (see tools/benchmark.cpp).
+void step_game_state(GameState &state, float delta_time);
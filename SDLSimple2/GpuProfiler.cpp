@@ -0,0 +1,107 @@
+#include <cstring>
+#include "GpuProfiler.h"
+#include "GLState.h"
+
+// Frames in flight before a query set is reused. Two is enough for the
+// short passes here; raise it if get_unavailable_results() keeps climbing.
+constexpr int QUERY_FRAME_LATENCY = 2;
+constexpr int MAX_GPU_PASSES      = 16;
+
+struct GpuPass
+{
+    const char* name;
+    uint64_t    submit_ns;
+};
+
+struct QueryFrame
+{
+    GLuint  query_ids[MAX_GPU_PASSES];
+    GpuPass passes[MAX_GPU_PASSES];
+    int     pass_count = 0;
+};
+
+static QueryFrame s_frames[QUERY_FRAME_LATENCY];
+static int        s_frame_index = 0;
+static bool       s_supported   = false;
+static bool       s_in_pass     = false;
+static uint32_t   s_unavailable = 0;
+
+static bool has_timer_queries()
+{
+    // Core since 3.3; older contexts (including macOS's 2.1) may expose it as an extension
+    if (gl_state::gl_version_at_least(3, 3)) return true;
+
+    const GLubyte* extensions = glGetString(GL_EXTENSIONS);
+    return extensions != nullptr &&
+           (strstr((const char*) extensions, "GL_ARB_timer_query") != nullptr ||
+            strstr((const char*) extensions, "GL_EXT_timer_query") != nullptr);
+}
+
+void gpu_profiler::initialise()
+{
+    s_supported = has_timer_queries();
+    if (!s_supported) return;
+
+    for (QueryFrame &frame : s_frames) glGenQueries(MAX_GPU_PASSES, frame.query_ids);
+}
+
+void gpu_profiler::shutdown()
+{
+    if (!s_supported) return;
+
+    for (QueryFrame &frame : s_frames) glDeleteQueries(MAX_GPU_PASSES, frame.query_ids);
+    s_supported = false;
+}
+
+void gpu_profiler::begin_frame()
+{
+    if (!s_supported) return;
+
+    s_frame_index = (s_frame_index + 1) % QUERY_FRAME_LATENCY;
+    QueryFrame &frame = s_frames[s_frame_index];
+
+    // Harvest what this set measured last time round before its queries are reused
+    for (int i = 0; i < frame.pass_count; i++)
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(frame.query_ids[i], GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (!available)
+        {
+            // Asking for the result now would stall, so this sample is dropped
+            s_unavailable++;
+            continue;
+        }
+
+        GLuint64 elapsed_ns = 0;
+        glGetQueryObjectui64v(frame.query_ids[i], GL_QUERY_RESULT, &elapsed_ns);
+
+        const GpuPass &pass = frame.passes[i];
+        profiler::record(pass.name, pass.submit_ns, pass.submit_ns + elapsed_ns, 0, profiler::GPU_TRACK);
+    }
+
+    frame.pass_count = 0;
+}
+
+bool gpu_profiler::begin_pass(const char* name)
+{
+    QueryFrame &frame = s_frames[s_frame_index];
+    if (!s_supported || s_in_pass || frame.pass_count >= MAX_GPU_PASSES) return false;
+
+    frame.passes[frame.pass_count] = { name, profiler::now_ns() };
+    glBeginQuery(GL_TIME_ELAPSED, frame.query_ids[frame.pass_count]);
+    s_in_pass = true;
+    return true;
+}
+
+void gpu_profiler::end_pass()
+{
+    if (!s_in_pass) return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    s_frames[s_frame_index].pass_count++;
+    s_in_pass = false;
+}
+
+bool     const gpu_profiler::is_supported()            { return s_supported; }
+uint32_t const gpu_profiler::get_unavailable_results() { return s_unavailable; }
@@ -0,0 +1,44 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include "Profiler.h"
+
+#if ENABLE_PROFILER
+#define GPU_ZONE(name) GpuZone PROFILE_CONCAT(gpu_zone_, __LINE__)(name)
+#else
+#define GPU_ZONE(name)
+#endif
+
+// GL_TIME_ELAPSED queries around render passes. Each frame uses its own set of
+// query objects and reads back the set from QUERY_FRAME_LATENCY frames ago, so
+// results are only collected once the GPU has long finished with them and
+// nothing waits on the driver. Finished passes go into the CPU profiler on its
+// GPU track, placed at the time they were submitted.
+//
+// Passes must not nest: only one GL_TIME_ELAPSED query can be active at a time.
+namespace gpu_profiler
+{
+    void initialise();
+    void shutdown();
+
+    void begin_frame();
+    bool begin_pass(const char* name); // False if the pass is not being timed
+    void end_pass();
+
+    bool     const is_supported();
+    uint32_t const get_unavailable_results();
+}
+
+class GpuZone
+{
+private:
+    bool m_timing;
+
+public:
+    GpuZone(const char* name) : m_timing(gpu_profiler::begin_pass(name)) { }
+    ~GpuZone() { if (m_timing) gpu_profiler::end_pass(); }
+};
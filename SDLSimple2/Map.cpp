@@ -1,31 +1,52 @@
 #include "Map.h"
+#include "GLState.h"
+#include "Profiler.h"
+#include "FrameStats.h"
 
-Map::Map(int width, int height, unsigned int *level_data, GLuint texture_id, float tile_size, int tile_count_x, int tile_count_y) :
-m_width(width), m_height(height), m_level_data(level_data), m_texture_id(texture_id), m_tile_size(tile_size), m_tile_count_x(tile_count_x), m_tile_count_y(tile_count_y)
+Map::Map(int width, int height, unsigned int *level_data, AtlasRegion region, float tile_size, int tile_count_x, int tile_count_y) :
+m_width(width), m_height(height), m_level_data(level_data), m_region(region), m_tile_size(tile_size), m_tile_count_x(tile_count_x), m_tile_count_y(tile_count_y)
 {
-    build();
+    // The bounds are dependent on the size of the tiles, so they never change
+    // once set here, whatever build() later does on the render thread
+    m_left_bound   = 0 - (m_tile_size / 2);
+    m_right_bound  = (m_tile_size * m_width) - (m_tile_size / 2);
+    m_top_bound    = 0 + (m_tile_size / 2);
+    m_bottom_bound = -(m_tile_size * m_height) + (m_tile_size / 2);
+    
+    // Filled once here and then kept up to date by set_tile, never by build()
+    m_solid_bits.assign((m_width * m_height + 63) / 64, 0);
+    for (int index = 0; index < m_width * m_height; index++)
+    {
+        if (m_level_data[index] != 0) m_solid_bits[index >> 6] |= uint64_t(1) << (index & 63);
+    }
+    
+    build(m_level_data);
 }
 
-void Map::build()
+void Map::build(const unsigned int *level_data)
 {
+    // Start over so rebuilding (e.g. after editing the level data) doesn't duplicate tiles
+    m_vertices.clear();
+    m_texture_coordinates.clear();
+    
     // Since this is a 2D map, we need a nested for-loop
     for(int y_coord = 0; y_coord < m_height; y_coord++)
     {
         for(int x_coord = 0; x_coord < m_width; x_coord++)
         {
             // Get the current tile
-            int tile = m_level_data[y_coord * m_width + x_coord];
+            int tile = level_data[y_coord * m_width + x_coord];
             
             // If the tile number is 0 i.e. not solid, skip to the next one
             if (tile == 0) continue;
             
-            // Otherwise, calculate its UV-coordinated
-            float u_coord = (float) (tile % m_tile_count_x) / (float) m_tile_count_x;
-            float v_coord = (float) (tile / m_tile_count_x) / (float) m_tile_count_y;
+            // Otherwise, calculate its UV-coordinated (relative to the tilesheet's atlas region)
+            float u_coord = m_region.u((float) (tile % m_tile_count_x) / (float) m_tile_count_x);
+            float v_coord = m_region.v((float) (tile / m_tile_count_x) / (float) m_tile_count_y);
             
             // And work out their dimensions and posititions
-            float tile_width = 1.0f/ (float)  m_tile_count_x;
-            float tile_height = 1.0f/ (float) m_tile_count_y;
+            float tile_width = m_region.uv_scale.x / (float)  m_tile_count_x;
+            float tile_height = m_region.uv_scale.y / (float) m_tile_count_y;
             
             float x_offset = -(m_tile_size / 2); // From center of tile
             float y_offset =  (m_tile_size / 2); // From center of tile
@@ -50,31 +71,39 @@ void Map::build()
             });
         }
     }
+}
+
+void Map::set_tile(int x, int y, unsigned int tile)
+{
+    if (x < 0 || x >= m_width || y < 0 || y >= m_height) return;
+    if (m_level_data[y * m_width + x] == tile) return;
     
-    // The bounds are dependent on the size of the tiles
-    m_left_bound   = 0 - (m_tile_size / 2);
-    m_right_bound  = (m_tile_size * m_width) - (m_tile_size / 2);
-    m_top_bound    = 0 + (m_tile_size / 2);
-    m_bottom_bound = -(m_tile_size * m_height) + (m_tile_size / 2);
+    int index = y * m_width + x;
+    m_level_data[index] = tile;
+    if (tile != 0) m_solid_bits[index >> 6] |=   uint64_t(1) << (index & 63);
+    else           m_solid_bits[index >> 6] &= ~(uint64_t(1) << (index & 63));
+    
+    m_changed_tiles.push_back(glm::ivec2(x, y));
+    m_revision++;
 }
 
 void Map::render(ShaderProgram *program)
 {
+    PROFILE_ZONE("Map::render");
+    
     glm::mat4 model_matrix = glm::mat4(1.0f);
     program->set_model_matrix(model_matrix);
     
-    glUseProgram(program->get_program_id());
+    gl_state::use_program(program->get_program_id());
     
     glVertexAttribPointer(program->get_position_attribute(), 2, GL_FLOAT, false, 0, m_vertices.data());
-    glEnableVertexAttribArray(program->get_position_attribute());
+    gl_state::enable_vertex_attribute(program->get_position_attribute());
     glVertexAttribPointer(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 0, m_texture_coordinates.data());
-    glEnableVertexAttribArray(program->get_tex_coordinate_attribute());
+    gl_state::enable_vertex_attribute(program->get_tex_coordinate_attribute());
     
-    glBindTexture(GL_TEXTURE_2D, m_texture_id);
+    gl_state::bind_texture(m_region.texture_id);
     
-    glDrawArrays(GL_TRIANGLES, 0, (int) m_vertices.size() / 2);
-    glDisableVertexAttribArray(program->get_position_attribute());
-    glDisableVertexAttribArray(program->get_tex_coordinate_attribute());
+    gl_state::draw_arrays(GL_TRIANGLES, 0, (int) m_vertices.size() / 2, CLIENT_VERTEX_BYTES);
 }
 
 bool Map::is_solid(glm::vec3 position, float *penetration_x, float *penetration_y)
@@ -84,6 +113,7 @@ bool Map::is_solid(glm::vec3 position, float *penetration_x, float *penetration_
     // to them in case that we are colliding. That way the object that originally
     // passed them as values will keep track of these distances
     // inb4: we're passing by reference
+    frame_stats::current().tiles_probed++;
     *penetration_x = 0;
     *penetration_y = 0;
     
@@ -112,3 +142,74 @@ bool Map::is_solid(glm::vec3 position, float *penetration_x, float *penetration_
     
     return true;
 }
+
+bool Map::raycast(const Ray &ray, RayHit *hit) const
+{
+    *hit = RayHit();
+    
+    // Work in tile units with y flipped to match the rows, so tile (x, y) spans
+    // [x, x + 1) by [y, y + 1) and its centre sits at world (x, -y) * tile size
+    glm::vec2 start     = glm::vec2(ray.origin.x, -ray.origin.y) / m_tile_size + 0.5f;
+    glm::vec2 direction = glm::vec2(ray.direction.x, -ray.direction.y) / m_tile_size;
+    
+    glm::ivec2 tile = glm::ivec2(glm::floor(start));
+    glm::ivec2 step = glm::ivec2(direction.x < 0 ? -1 : 1, direction.y < 0 ? -1 : 1);
+    
+    // World distance to cross one whole tile along each axis, and to reach the next edge
+    glm::vec2 delta = glm::vec2(direction.x != 0 ? fabs(1.0f / direction.x) : INFINITY,
+                                direction.y != 0 ? fabs(1.0f / direction.y) : INFINITY);
+    glm::vec2 next  = glm::vec2((step.x > 0 ? tile.x + 1 - start.x : start.x - tile.x) * delta.x,
+                                (step.y > 0 ? tile.y + 1 - start.y : start.y - tile.y) * delta.y);
+    
+    float distance = 0.0f;
+    glm::vec2 normal = glm::vec2(0.0f);
+    
+    while (distance <= ray.max_distance)
+    {
+        if (is_solid_tile(tile.x, tile.y))
+        {
+            hit->hit      = true;
+            hit->distance = distance;
+            hit->point    = ray.origin + ray.direction * distance;
+            hit->tile     = tile;
+            hit->normal   = normal;
+            return true;
+        }
+        
+        // Off the map and still heading away from it: nothing left to hit
+        if ((tile.x < 0 && step.x < 0) || (tile.x >= m_width  && step.x > 0) ||
+            (tile.y < 0 && step.y < 0) || (tile.y >= m_height && step.y > 0)) return false;
+        
+        if (next.x < next.y)
+        {
+            distance = next.x;
+            next.x  += delta.x;
+            tile.x  += step.x;
+            normal   = glm::vec2(-step.x, 0.0f);
+        }
+        else
+        {
+            distance = next.y;
+            next.y  += delta.y;
+            tile.y  += step.y;
+            normal   = glm::vec2(0.0f, step.y); // Rows count down the screen
+        }
+    }
+    return false;
+}
+
+void Map::raycast(const Ray *rays, int count, RayHit *hits) const
+{
+    PROFILE_ZONE("Map::raycast batch");
+    for (int i = 0; i < count; i++) raycast(rays[i], &hits[i]);
+}
+
+bool Map::has_line_of_sight(glm::vec2 from, glm::vec2 to) const
+{
+    glm::vec2 offset = to - from;
+    float distance = glm::length(offset);
+    if (distance == 0.0f) return !is_solid_tile((int) floor(from.x / m_tile_size + 0.5f), (int) floor(-from.y / m_tile_size + 0.5f));
+    
+    RayHit hit;
+    return !raycast({ from, offset / distance, distance }, &hit);
+}
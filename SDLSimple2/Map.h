@@ -12,6 +12,24 @@
 #include "glm/mat4x4.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "ShaderProgram.h"
+#include "TextureAtlas.h"
+
+// A ray in world space. direction must be normalised; distances are in world units.
+struct Ray
+{
+    glm::vec2 origin;
+    glm::vec2 direction;
+    float     max_distance;
+};
+
+struct RayHit
+{
+    bool       hit      = false;
+    float      distance = 0.0f;             // Along the ray to where it entered the tile
+    glm::vec2  point    = glm::vec2(0.0f);
+    glm::ivec2 tile     = glm::ivec2(0);    // Column and row in the level data
+    glm::vec2  normal   = glm::vec2(0.0f);  // Face that was hit; zero if the ray started inside it
+};
 
 class Map {
 private:
@@ -20,36 +38,72 @@ private:
     
     // Here, the level_data is the numerical "drawing" of the map
     unsigned int *m_level_data;
-    GLuint m_texture_id;
+    AtlasRegion m_region; // Where the tilesheet lives, possibly inside a larger atlas
     
     float m_tile_size;
     int   m_tile_count_x;
     int   m_tile_count_y;
     
     // Just like with rendering text, we're rendering several sprites at once
-    // So we need vectors to store their respective vertices and texture coordinates
+    // So we need vectors to store their respective vertices and texture coordinates.
+    // Render thread only once the map is built, like build() and render().
     std::vector<float> m_vertices;
     std::vector<float> m_texture_coordinates;
     
-    // The boundaries of the map
+    // The boundaries of the map. Set once by the constructor, so both threads can read them
     float m_left_bound, m_right_bound, m_top_bound, m_bottom_bound;
     
+    // One bit per tile, row by row, set where the level data is non-zero. Much
+    // smaller than the level data, so long rays stay in cache. Simulation
+    // thread only, like the level data: written by the constructor and set_tile.
+    std::vector<uint64_t> m_solid_bits;
+    
+    // Tiles set since the simulation last looked, so whatever rests on them can react
+    std::vector<glm::ivec2> m_changed_tiles;
+    // Counts set_tile edits, so a copy of the level data can tell it is out of date
+    unsigned int m_revision = 0;
+    
 public:
     // Constructor
-    Map(int width, int height, unsigned int *level_data, GLuint texture_id, float tile_size, int
+    Map(int width, int height, unsigned int *level_data, AtlasRegion region, float tile_size, int
     tile_count_x, int tile_count_y);
     
     // Methods
-    void build();
+    // Makes the vertices from level data laid out like the map's own, e.g. the
+    // copy in a RenderSnapshot, so the render thread never reads the live tiles.
+    // Writes only the vertices and texture coordinates.
+    void build(const unsigned int *level_data);
     void render(ShaderProgram *program);
     bool is_solid(glm::vec3 position, float *penetration_x, float *penetration_y);
     
+    // Grid traversal (Amanatides & Woo) to the first solid tile along the ray.
+    // Outside the map counts as empty, as it does for is_solid.
+    bool raycast(const Ray &ray, RayHit *hit) const;
+    void raycast(const Ray *rays, int count, RayHit *hits) const;
+    bool has_line_of_sight(glm::vec2 from, glm::vec2 to) const;
+    
+    // For the simulation thread; the change shows up on screen once a snapshot
+    // carries it and the render thread rebuilds from that
+    void set_tile(int x, int y, unsigned int tile);
+    void clear_changed_tiles() { m_changed_tiles.clear(); }
+    
     // Getters
     int const get_width()  const  { return m_width;  }
     int const get_height() const  { return m_height; }
     
     unsigned int* const get_level_data() const { return m_level_data; }
-    GLuint        const get_texture_id() const { return m_texture_id; }
+    unsigned int  const get_revision()   const { return m_revision; }
+    GLuint        const get_texture_id() const { return m_region.texture_id; }
+    AtlasRegion   const get_region()     const { return m_region; }
+    
+    std::vector<glm::ivec2> const &get_changed_tiles() const { return m_changed_tiles; }
+    
+    bool const is_solid_tile(int x, int y) const
+    {
+        if (x < 0 || x >= m_width || y < 0 || y >= m_height) return false;
+        int index = y * m_width + x;
+        return (m_solid_bits[index >> 6] >> (index & 63)) & 1;
+    }
     
     float const get_tile_size()    const { return m_tile_size;    }
     int   const get_tile_count_x() const { return m_tile_count_x; }
@@ -0,0 +1,721 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include "NavGraph.h"
+#include "Entity.h"
+#include "FileCache.h"
+#include "Profiler.h"
+
+namespace
+{
+    // Bumped whenever the way arcs are simulated changes, so old caches miss
+    constexpr uint32_t CACHE_VERSION   = 1;
+    constexpr char     CACHE_MAGIC[8]  = { 'S', 'D', 'L', 'N', 'A', 'V', '1', '\0' };
+
+    struct CacheHeader
+    {
+        char     magic[8];
+        uint64_t key;
+        uint32_t node_count;
+        uint32_t edge_count;
+    };
+
+    // Feet resting on a tile are exactly on its top edge; this puts them inside the tile above
+    constexpr float EDGE_EPSILON = 0.001f;
+
+    std::string cache_filepath(uint64_t key)
+    {
+        return file_cache::filepath(NAV_CACHE_DIRECTORY, key, "nav");
+    }
+
+    // Columns an arc can carry an entity sideways
+    int reach_of(const NavPhysics &physics, float tile_size)
+    {
+        return (int) std::ceil((std::max(physics.speed, 0.0f) * NAV_MAX_AIRTIME + physics.width) / tile_size) + 1;
+    }
+
+    // Only the cheapest way from one node to another is kept. Edges of from are
+    // the last ones added, since nodes are filled in one at a time.
+    void add_edge(std::vector<NavEdge> &edges, int from, int to, float cost, NavEdgeType type, int direction)
+    {
+        if (to < 0 || to == from) return;
+
+        for (int edge = (int) edges.size() - 1; edge >= 0 && edges[edge].from == from; edge--)
+        {
+            if (edges[edge].to != to) continue;
+            if (cost < edges[edge].cost) edges[edge] = { from, to, cost, type, (int8_t) direction };
+            return;
+        }
+        edges.push_back({ from, to, cost, type, (int8_t) direction });
+    }
+}
+
+NavPhysics const nav_physics_of(const Entity &entity)
+{
+    return { entity.get_speed(), entity.get_jumping_power(), entity.get_acceleration().y, entity.get_width(), entity.get_height() };
+}
+
+// Open, with solid ground under it and room above for the entity's height
+bool const NavGraph::is_standable(int column, int row) const
+{
+    if (row < 0 || row + 1 >= m_map->get_height() || !m_map->is_solid_tile(column, row + 1)) return false;
+
+    int clearance = std::max(1, (int) std::ceil(m_physics.height / m_map->get_tile_size() - EDGE_EPSILON));
+    for (int above = 0; above < clearance; above++)
+    {
+        if (m_map->is_solid_tile(column, row - above)) return false;
+    }
+    return true;
+}
+
+int const NavGraph::find_node(glm::ivec2 tile) const
+{
+    if (tile.x < 0 || tile.x >= (int) m_node_blocks.starts.size()) return -1;
+
+    for (int node = m_node_blocks.starts[tile.x]; node < m_node_blocks.ends[tile.x]; node++)
+    {
+        if (m_nodes[node].y == tile.y) return node;
+    }
+    return -1;
+}
+
+// Where Entity::check_collision_y probes for ground: under the middle of the
+// feet, then under either side in case only that one is still on a ledge
+void NavGraph::ground_tiles(glm::vec2 feet, float half_width, glm::ivec2 tiles[3]) const
+{
+    float tile_size = m_map->get_tile_size();
+    int   row       = (int) std::floor(-(feet.y + EDGE_EPSILON) / tile_size + 0.5f);
+
+    tiles[0] = glm::ivec2((int) std::floor(feet.x / tile_size + 0.5f), row);
+    tiles[1] = glm::ivec2((int) std::floor((feet.x - half_width) / tile_size + 0.5f), row);
+    tiles[2] = glm::ivec2((int) std::floor((feet.x + half_width) / tile_size + 0.5f), row);
+}
+
+int const NavGraph::standing_node(glm::vec2 feet, float half_width) const
+{
+    glm::ivec2 tiles[3];
+    ground_tiles(feet, half_width, tiles);
+    for (glm::ivec2 tile : tiles)
+    {
+        int node = find_node(tile);
+        if (node >= 0) return node;
+    }
+    return -1;
+}
+
+// The first node in position's column at or below it, i.e. where something
+// there lands if it drops
+int const NavGraph::node_below(glm::vec3 position) const
+{
+    float tile_size = m_map->get_tile_size();
+    int column = (int) std::floor(position.x / tile_size + 0.5f);
+    int row    = (int) std::floor(-position.y / tile_size + 0.5f);
+    if (column < 0 || column >= m_map->get_width()) return -1;
+
+    for (int node = m_node_blocks.starts[column]; node < m_node_blocks.ends[column]; node++)
+    {
+        if (m_nodes[node].y >= row) return node;
+    }
+    return -1;
+}
+
+// Runs a stand-in entity with the graph's physics through Entity::update from
+// standing on tile, with direction held. A jump is added where Entity::update
+// adds one, after the first step's collisions, but set directly so no jump
+// event goes out. The standable tile it comes to rest on once it has left the
+// ground, as row * width + column, or -1 if it leaves the map or is still in
+// the air after NAV_MAX_AIRTIME. Tiles rather than nodes, since the nodes in
+// edited columns are only rescanned once every arc near them has been.
+int NavGraph::simulate_arc(glm::ivec2 tile, float direction, float vertical_speed, float* airtime) const
+{
+    float tile_size = m_map->get_tile_size();
+
+    // A fall starts with a walk to the ledge, which is only flat ground, so the
+    // stand-in starts a couple of steps short of where it loses its footing
+    // and the steps it skipped are added to the time. x is stepped exactly as
+    // Entity::update steps it, since landing a hair either side of a tile's
+    // edge can decide whether it falls at all.
+    float start_x    = tile.x * tile_size;
+    int   lead_steps = 0;
+    if (vertical_speed == 0.0f)
+    {
+        float velocity_x = direction * m_physics.speed;
+        float ledge      = tile_size / 2.0f + m_physics.width / 2.0f - 2.0f * m_physics.speed * NAV_SIMULATION_STEP;
+
+        for (; std::fabs(start_x - tile.x * tile_size) < ledge; lead_steps++) start_x += velocity_x * NAV_SIMULATION_STEP;
+    }
+
+    Entity body(AtlasRegion(), m_physics.speed, m_physics.width, m_physics.height, ENEMY, WALKER, IDLE);
+    body.set_has_external_ai(true);
+    body.set_acceleration(glm::vec3(0.0f, m_physics.gravity, 0.0f));
+    body.set_position(glm::vec3(start_x, -tile.y * tile_size - tile_size / 2.0f + m_physics.height / 2.0f, 0.0f));
+    body.set_movement(glm::vec3(direction, 0.0f, 0.0f));
+
+    // Being on the ground only ends the arc once it has been off it
+    bool is_airborne = false;
+
+    int max_steps = (int) (NAV_MAX_AIRTIME / NAV_SIMULATION_STEP);
+    for (int step = 1; step <= max_steps; step++)
+    {
+        body.update(NAV_SIMULATION_STEP, nullptr, 0, m_map);
+        if (step == 1 && vertical_speed != 0.0f) body.set_velocity(body.get_velocity() + glm::vec3(0.0f, vertical_speed, 0.0f));
+
+        glm::vec3 position = body.get_position();
+        if (!body.get_collided_bottom())
+        {
+            is_airborne = true;
+        }
+        else if (is_airborne)
+        {
+            *airtime = (step + lead_steps) * NAV_SIMULATION_STEP;
+
+            glm::ivec2 tiles[3];
+            ground_tiles(glm::vec2(position.x, position.y - m_physics.height / 2.0f), m_physics.width / 2.0f, tiles);
+            for (glm::ivec2 landing : tiles)
+            {
+                if (landing.x >= 0 && landing.x < m_map->get_width() && is_standable(landing.x, landing.y)) return landing.y * m_map->get_width() + landing.x;
+            }
+            return -1;
+        }
+
+        if (position.y < m_map->get_bottom_bound() || position.x < m_map->get_left_bound() || position.x > m_map->get_right_bound()) return -1;
+    }
+    return -1;
+}
+
+// Empty, with every column's blocks empty too, and no routes kept
+void NavGraph::reset()
+{
+    int width = m_map->get_width();
+
+    m_nodes.clear();
+    m_edges.clear();
+    m_incoming.clear();
+    m_incoming_starts.clear();
+    m_incoming_ends.clear();
+    m_node_blocks.reset(width);
+    m_edge_blocks.reset(width);
+    m_incoming_blocks.reset(width);
+
+    m_dirty_columns.clear();
+    m_regeneration = Regeneration();
+
+    for (FlowField &field : m_flow_fields) field.goal = -1;
+}
+
+// Takes the lowest edited column, and every other one close enough that
+// their reach overlaps, as the next regeneration
+void NavGraph::start_regeneration()
+{
+    std::sort(m_dirty_columns.begin(), m_dirty_columns.end());
+    m_dirty_columns.erase(std::unique(m_dirty_columns.begin(), m_dirty_columns.end()), m_dirty_columns.end());
+
+    size_t end = 1;
+    while (end < m_dirty_columns.size() && m_dirty_columns[end] - m_dirty_columns[end - 1] <= 2 * m_reach) end++;
+
+    Regeneration &regeneration = m_regeneration;
+    regeneration.columns.assign(m_dirty_columns.begin(), m_dirty_columns.begin() + end);
+    regeneration.first_column = std::max(regeneration.columns.front() - m_reach, 0);
+    regeneration.last_column  = std::min(regeneration.columns.back() + m_reach, m_map->get_width() - 1);
+    regeneration.next_column  = regeneration.first_column;
+    regeneration.next_row     = 0;
+    regeneration.next_move    = 0;
+    regeneration.edges.clear();
+    regeneration.edge_ends.clear();
+
+    m_dirty_columns.erase(m_dirty_columns.begin(), m_dirty_columns.begin() + end);
+}
+
+// Simulates the regeneration's next edge out of a standable tile, against the
+// map as it is now: each tile has a walk or fall and a jump either way, and an
+// arc can take a while. Finishes it after the last column. False if nothing
+// was left to do.
+bool NavGraph::step_regeneration()
+{
+    if (m_regeneration.columns.empty())
+    {
+        if (m_dirty_columns.empty()) return false;
+        start_regeneration();
+    }
+
+    Regeneration &regeneration = m_regeneration;
+    int width  = m_map->get_width();
+    int column = regeneration.next_column;
+    int row    = regeneration.next_row;
+
+    // Nothing gets anywhere without moving sideways
+    if (regeneration.next_move == 0)
+    {
+        while (row < m_map->get_height() && !(m_physics.speed > 0.0f && is_standable(column, row))) row++;
+    }
+
+    if (row < m_map->get_height())
+    {
+        glm::ivec2 tile      = glm::ivec2(column, row);
+        int        from      = row * width + column;
+        int        direction = regeneration.next_move < 2 ? -1 : 1;
+        glm::ivec2 next      = tile + glm::ivec2(direction, 0);
+        float      airtime;
+
+        if (regeneration.next_move % 2 == 1)
+        {
+            int landing = simulate_arc(tile, (float) direction, m_physics.jumping_power, &airtime);
+            if (m_physics.jumping_power > 0.0f) add_edge(regeneration.edges, from, landing, airtime, NAV_JUMP, direction);
+        }
+        else if (next.x >= 0 && next.x < width && is_standable(next.x, next.y))
+        {
+            add_edge(regeneration.edges, from, next.y * width + next.x, m_map->get_tile_size() / m_physics.speed, NAV_WALK, direction);
+        }
+        else if (!m_map->is_solid_tile(next.x, next.y))
+        {
+            int landing = simulate_arc(tile, (float) direction, 0.0f, &airtime);
+            add_edge(regeneration.edges, from, landing, airtime, NAV_FALL, direction);
+        }
+
+        regeneration.next_row  = row;
+        regeneration.next_move = (regeneration.next_move + 1) % 4;
+        if (regeneration.next_move != 0 || ++regeneration.next_row < m_map->get_height()) return true;
+    }
+
+    regeneration.edge_ends.push_back((int) regeneration.edges.size());
+    regeneration.next_column++;
+    regeneration.next_row = 0;
+    if (regeneration.next_column > regeneration.last_column) finish_regeneration();
+    return true;
+}
+
+// Rescans the nodes in the edited columns and swaps the simulated edges in
+// for the old ones, rewriting only those columns' blocks. Edges can only lead
+// up to m_reach columns away, so outside that the edges into each node stay
+// as they were, and so do the routes that never got that close. Tiles that
+// stopped being standable since they were simulated lose their edges here,
+// and get new ones from the regeneration their edit queued.
+void NavGraph::finish_regeneration()
+{
+    PROFILE_ZONE("NavGraph::finish_regeneration");
+
+    Regeneration &regeneration = m_regeneration;
+    int width         = m_map->get_width();
+    int first_reached = std::max(regeneration.first_column - m_reach, 0);
+    int last_reached  = std::min(regeneration.last_column + m_reach, width - 1);
+    forget_routes(first_reached, last_reached);
+
+    std::vector<glm::ivec2> nodes;
+    for (int column : regeneration.columns)
+    {
+        nodes.clear();
+        for (int row = 0; row < m_map->get_height(); row++)
+        {
+            if (is_standable(column, row)) nodes.push_back(glm::ivec2(column, row));
+        }
+
+        m_node_blocks.fit(m_nodes, column, (int) nodes.size());
+        std::copy(nodes.begin(), nodes.end(), m_nodes.begin() + m_node_blocks.starts[column]);
+    }
+
+    std::vector<NavEdge> edges;
+    int simulated = 0;
+    for (int column = regeneration.first_column; column <= regeneration.last_column; column++)
+    {
+        edges.clear();
+        for (int edge = simulated; edge < regeneration.edge_ends[column - regeneration.first_column]; edge++)
+        {
+            NavEdge found = regeneration.edges[edge];
+            found.from = find_node(glm::ivec2(found.from % width, found.from / width));
+            found.to   = find_node(glm::ivec2(found.to   % width, found.to   / width));
+            if (found.from >= 0 && found.to >= 0) edges.push_back(found);
+        }
+        simulated = regeneration.edge_ends[column - regeneration.first_column];
+
+        m_edge_blocks.fit(m_edges, column, (int) edges.size());
+        std::copy(edges.begin(), edges.end(), m_edges.begin() + m_edge_blocks.starts[column]);
+    }
+
+    index_edges(first_reached, last_reached);
+    m_regeneration = Regeneration();
+}
+
+// Counting sort, by the node they lead to, of the edges into the given
+// columns, which can only come from columns up to m_reach further out
+void NavGraph::index_edges(int first_column, int last_column)
+{
+    int first_source = std::max(first_column - m_reach, 0);
+    int last_source  = std::min(last_column + m_reach, m_map->get_width() - 1);
+
+    m_incoming_starts.resize(m_nodes.size(), 0);
+    m_incoming_ends.resize(m_nodes.size(), 0);
+
+    auto is_indexed = [&](int node) { return m_nodes[node].x >= first_column && m_nodes[node].x <= last_column; };
+
+    // Counted in m_incoming_ends to begin with
+    for (int column = first_column; column <= last_column; column++)
+    {
+        for (int node = m_node_blocks.starts[column]; node < m_node_blocks.ends[column]; node++) m_incoming_ends[node] = 0;
+    }
+    for (int column = first_source; column <= last_source; column++)
+    {
+        for (int edge = m_edge_blocks.starts[column]; edge < m_edge_blocks.ends[column]; edge++)
+        {
+            if (is_indexed(m_edges[edge].to)) m_incoming_ends[m_edges[edge].to]++;
+        }
+    }
+
+    for (int column = first_column; column <= last_column; column++)
+    {
+        int count = 0;
+        for (int node = m_node_blocks.starts[column]; node < m_node_blocks.ends[column]; node++) count += m_incoming_ends[node];
+
+        m_incoming_blocks.fit(m_incoming, column, count);
+        int start = m_incoming_blocks.starts[column];
+        for (int node = m_node_blocks.starts[column]; node < m_node_blocks.ends[column]; node++)
+        {
+            int incoming = m_incoming_ends[node];
+            m_incoming_starts[node] = m_incoming_ends[node] = start;
+            start += incoming;
+        }
+    }
+
+    for (int column = first_source; column <= last_source; column++)
+    {
+        for (int edge = m_edge_blocks.starts[column]; edge < m_edge_blocks.ends[column]; edge++)
+        {
+            if (is_indexed(m_edges[edge].to)) m_incoming[m_incoming_ends[m_edges[edge].to]++] = edge;
+        }
+    }
+}
+
+// Drops the routes that reached any node in the given columns. One that never
+// got there never came across an edge into them, so edges out of them can't
+// have changed it.
+void NavGraph::forget_routes(int first_column, int last_column)
+{
+    for (FlowField &field : m_flow_fields)
+    {
+        for (int column = first_column; column <= last_column && field.goal >= 0; column++)
+        {
+            for (int node = m_node_blocks.starts[column]; node < m_node_blocks.ends[column]; node++)
+            {
+                if (node >= (int) field.costs.size() || field.costs[node] == FLT_MAX) continue;
+                field.goal = -1;
+                break;
+            }
+        }
+    }
+}
+
+// The nodes column by column and the edges grouped by from, without the
+// blocks' spare room, and with the edges renumbered to match
+void NavGraph::pack(std::vector<glm::ivec2>* nodes, std::vector<NavEdge>* edges) const
+{
+    std::vector<int> packed(m_nodes.size(), -1);
+    nodes->clear();
+    edges->clear();
+
+    for (int column = 0; column < (int) m_node_blocks.starts.size(); column++)
+    {
+        for (int node = m_node_blocks.starts[column]; node < m_node_blocks.ends[column]; node++)
+        {
+            packed[node] = (int) nodes->size();
+            nodes->push_back(m_nodes[node]);
+        }
+    }
+    for (int column = 0; column < (int) m_edge_blocks.starts.size(); column++)
+    {
+        for (int edge = m_edge_blocks.starts[column]; edge < m_edge_blocks.ends[column]; edge++)
+        {
+            NavEdge moved = m_edges[edge];
+            moved.from = packed[moved.from];
+            moved.to   = packed[moved.to];
+            edges->push_back(moved);
+        }
+    }
+}
+
+std::vector<glm::ivec2> const NavGraph::get_nodes() const
+{
+    std::vector<glm::ivec2> nodes;
+    std::vector<NavEdge>    edges;
+    pack(&nodes, &edges);
+    return nodes;
+}
+
+std::vector<NavEdge> const NavGraph::get_edges() const
+{
+    std::vector<glm::ivec2> nodes;
+    std::vector<NavEdge>    edges;
+    pack(&nodes, &edges);
+    return edges;
+}
+
+uint64_t const NavGraph::cache_key() const
+{
+    int   width     = m_map->get_width(),
+          height    = m_map->get_height();
+    float tile_size = m_map->get_tile_size();
+
+    uint64_t key = file_cache::hash_bytes(&CACHE_VERSION, sizeof(CACHE_VERSION));
+    key = file_cache::hash_bytes(&width,     sizeof(width),     key);
+    key = file_cache::hash_bytes(&height,    sizeof(height),    key);
+    key = file_cache::hash_bytes(&tile_size, sizeof(tile_size), key);
+    key = file_cache::hash_bytes(&m_physics, sizeof(m_physics), key);
+
+    // Only whether tiles are solid matters, not which tile they are
+    std::vector<uint8_t> solid((width * height + 7) / 8, 0);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int index = y * width + x;
+            if (m_map->is_solid_tile(x, y)) solid[index >> 3] |= 1 << (index & 7);
+        }
+    }
+    return file_cache::hash_bytes(solid.data(), solid.size(), key);
+}
+
+bool NavGraph::load_cache(uint64_t key)
+{
+    std::ifstream infile(cache_filepath(key), std::ios::binary);
+    if (infile.fail()) return false;
+
+    CacheHeader header;
+    infile.read((char*) &header, sizeof(header));
+    if (!infile || std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.key != key) return false;
+
+    std::vector<glm::ivec2> nodes(header.node_count);
+    std::vector<NavEdge>    edges(header.edge_count);
+    infile.read((char*) nodes.data(), nodes.size() * sizeof(glm::ivec2));
+    infile.read((char*) edges.data(), edges.size() * sizeof(NavEdge));
+    if (!infile) return false;
+
+    // A damaged file must not index out of bounds; it is generated again instead
+    int width = m_map->get_width();
+    for (size_t node = 0; node < nodes.size(); node++)
+    {
+        if (nodes[node].x < 0 || nodes[node].x >= width) return false;
+        if (node > 0 && nodes[node].x < nodes[node - 1].x) return false;
+    }
+    for (size_t edge = 0; edge < edges.size(); edge++)
+    {
+        if (edges[edge].from < 0 || edges[edge].from >= (int) nodes.size() || edges[edge].to < 0 || edges[edge].to >= (int) nodes.size()) return false;
+        if (edge > 0 && edges[edge].from < edges[edge - 1].from) return false;
+    }
+
+    reset();
+    m_nodes = std::move(nodes);
+    m_edges = std::move(edges);
+
+    std::vector<int> node_counts(width, 0), edge_counts(width, 0);
+    for (glm::ivec2 node : m_nodes) node_counts[node.x]++;
+    for (const NavEdge &edge : m_edges) edge_counts[m_nodes[edge.from].x]++;
+    m_node_blocks.pack(node_counts);
+    m_edge_blocks.pack(edge_counts);
+
+    index_edges(0, width - 1);
+    return true;
+}
+
+void NavGraph::save_cache(uint64_t key) const
+{
+    std::error_code error;
+    std::filesystem::create_directories(NAV_CACHE_DIRECTORY, error);
+
+    std::ofstream outfile(cache_filepath(key), std::ios::binary);
+    if (outfile.fail())
+    {
+        std::cout << "Unable to write navigation cache to " << NAV_CACHE_DIRECTORY << std::endl;
+        return;
+    }
+
+    std::vector<glm::ivec2> nodes;
+    std::vector<NavEdge>    edges;
+    pack(&nodes, &edges);
+
+    CacheHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.key        = key;
+    header.node_count = (uint32_t) nodes.size();
+    header.edge_count = (uint32_t) edges.size();
+
+    outfile.write((const char*) &header, sizeof(header));
+    outfile.write((const char*) nodes.data(), nodes.size() * sizeof(glm::ivec2));
+    outfile.write((const char*) edges.data(), edges.size() * sizeof(NavEdge));
+}
+
+void NavGraph::build(Map* map, const NavPhysics &physics)
+{
+    PROFILE_ZONE("NavGraph::build");
+
+    m_map     = map;
+    m_physics = physics;
+    m_reach   = reach_of(physics, map->get_tile_size());
+
+    uint64_t key = cache_key();
+    if (load_cache(key)) return;
+
+    generate(map, physics);
+    save_cache(key);
+}
+
+void NavGraph::generate(Map* map, const NavPhysics &physics)
+{
+    PROFILE_ZONE("NavGraph::generate");
+
+    m_map     = map;
+    m_physics = physics;
+    m_reach   = reach_of(physics, map->get_tile_size());
+
+    reset();
+    for (int column = 0; column < map->get_width(); column++) m_dirty_columns.push_back(column);
+    while (step_regeneration());
+}
+
+// Whether a node exists only depends on its own column, but an arc can pass
+// through tiles up to m_reach columns away, so every node that close is
+// simulated again, by update() over the steps that follow
+void NavGraph::update_tiles(const std::vector<glm::ivec2> &tiles)
+{
+    if (m_map == nullptr) return;
+    for (glm::ivec2 tile : tiles) m_dirty_columns.push_back(tile.x);
+}
+
+// An edge at a time until the budget is spent, and at least one
+void NavGraph::update()
+{
+    if (m_regeneration.columns.empty() && m_dirty_columns.empty()) return;
+    PROFILE_ZONE("NavGraph::update");
+
+    uint64_t start  = profiler::now_ns();
+    uint64_t budget = (uint64_t) (NAV_STEP_BUDGET_MS * 1e6f);
+    while (step_regeneration() && profiler::now_ns() - start < budget);
+}
+
+// Dijkstra backwards from goal over the incoming edges, so every node it
+// reaches learns its first step towards goal in one search
+const NavGraph::FlowField &NavGraph::flow_field(int goal)
+{
+    m_flow_clock++;
+
+    FlowField* field = &m_flow_fields[0];
+    for (FlowField &candidate : m_flow_fields)
+    {
+        if (candidate.goal == goal)
+        {
+            // Nodes added since are in columns it never reached, or it would have been dropped
+            candidate.costs.resize(m_nodes.size(), FLT_MAX);
+            candidate.next_edges.resize(m_nodes.size(), -1);
+            candidate.last_used = m_flow_clock;
+            return candidate;
+        }
+        if (candidate.last_used < field->last_used) field = &candidate;
+    }
+
+    PROFILE_ZONE("NavGraph::flow_field");
+    field->goal      = goal;
+    field->last_used = m_flow_clock;
+    field->costs.assign(m_nodes.size(), FLT_MAX);
+    field->next_edges.assign(m_nodes.size(), -1);
+
+    using Entry = std::pair<float, int>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+    field->costs[goal] = 0.0f;
+    open.push({ 0.0f, goal });
+
+    for (int expanded = 0; !open.empty() && expanded < NAV_SEARCH_LIMIT; )
+    {
+        auto [cost, node] = open.top();
+        open.pop();
+        if (cost > field->costs[node]) continue;
+        expanded++;
+
+        for (int incoming = m_incoming_starts[node]; incoming < m_incoming_ends[node]; incoming++)
+        {
+            const NavEdge &edge = m_edges[m_incoming[incoming]];
+            float next_cost = cost + edge.cost;
+            if (next_cost >= field->costs[edge.from]) continue;
+
+            field->costs[edge.from]      = next_cost;
+            field->next_edges[edge.from] = m_incoming[incoming];
+            open.push({ next_cost, edge.from });
+        }
+    }
+    return *field;
+}
+
+bool NavGraph::steer(const Entity &entity, glm::vec3 target, NavSteering* steering)
+{
+    steering->direction = entity.get_movement().x;
+    steering->jump      = false;
+    if (m_nodes.empty()) return false;
+
+    // Committed to whatever arc it is on until it lands. A jump only lifts off
+    // on the step after it is asked for, with the ground still under it.
+    if (!entity.get_collided_bottom() || entity.get_velocity().y > 0.0f) return true;
+
+    glm::vec3 position = entity.get_position();
+    int from = standing_node(glm::vec2(position.x, position.y - entity.get_height() / 2.0f), entity.get_width() / 2.0f);
+    int goal = node_below(target);
+    if (goal < 0) return false;
+
+    // Between nodes, e.g. stepping over a gap narrower than it is: keeps going
+    // unless that has run it into something
+    if (from < 0)
+    {
+        bool is_blocked = entity.get_collided_left() || entity.get_collided_right();
+        return steering->direction != 0.0f && !is_blocked;
+    }
+
+    if (from == goal)
+    {
+        steering->direction = position.x > target.x ? -1.0f : 1.0f;
+        return true;
+    }
+
+    int next_edge = flow_field(goal).next_edges[from];
+    if (next_edge < 0) return false;
+
+    const NavEdge &edge = m_edges[next_edge];
+    steering->direction = edge.direction;
+
+    // Jumps were simulated from the middle of the tile, so it lines up first
+    if (edge.type == NAV_JUMP)
+    {
+        float offset = m_nodes[from].x * m_map->get_tile_size() - position.x;
+        if (std::fabs(offset) > NAV_TAKEOFF_TOLERANCE * m_map->get_tile_size()) steering->direction = offset < 0.0f ? -1.0f : 1.0f;
+        else                                                                      steering->jump = true;
+    }
+    return true;
+}
+
+float NavGraph::path_cost(const Entity &entity, glm::vec3 target)
+{
+    if (m_nodes.empty()) return FLT_MAX;
+
+    glm::vec3 position = entity.get_position();
+    int from = entity.get_collided_bottom()
+        ? standing_node(glm::vec2(position.x, position.y - entity.get_height() / 2.0f), entity.get_width() / 2.0f)
+        : node_below(position);
+    int goal = node_below(target);
+    if (from < 0 || goal < 0) return FLT_MAX;
+
+    return flow_field(goal).costs[from];
+}
+
+void steer_towards(NavGraph* nav_graph, Entity* entity, glm::vec3 target)
+{
+    NavSteering steering;
+    if (nav_graph != nullptr && nav_graph->steer(*entity, target, &steering))
+    {
+        entity->set_movement(glm::vec3(steering.direction, 0.0f, 0.0f));
+        if (steering.jump) entity->jump();
+        return;
+    }
+    entity->set_movement(glm::vec3(entity->get_position().x > target.x ? -1.0f : 1.0f, 0.0f, 0.0f));
+}
@@ -0,0 +1,216 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "Map.h"
+
+class Entity;
+
+constexpr float NAV_SIMULATION_STEP   = 0.0166666f;   // FIXED_TIMESTEP in main.cpp
+constexpr float NAV_MAX_AIRTIME       = 3.0f;         // Arcs still in the air after this many seconds are dropped
+constexpr float NAV_TAKEOFF_TOLERANCE = 0.05f;        // Tiles off the middle of a ledge a jump still takes off from
+constexpr int   NAV_SEARCH_LIMIT      = 4096;         // Nodes a route search expands, so its cost doesn't grow with the level
+constexpr int   NAV_FLOW_FIELDS       = 4;            // Goals whose routes are kept at once
+constexpr float NAV_STEP_BUDGET_MS    = 1.0f;         // Spent each step catching up with edits, an edge at a time
+
+constexpr char NAV_CACHE_DIRECTORY[] = "nav_cache";
+
+// The parts of an Entity's movement that decide where it can get to. Its
+// x velocity is speed times its movement, and a jump adds jumping_power to
+// its y velocity; gravity is its y acceleration (negative is down).
+struct NavPhysics
+{
+    float speed;
+    float jumping_power;
+    float gravity;
+    float width, height;
+};
+
+NavPhysics const nav_physics_of(const Entity &entity);
+
+enum NavEdgeType : uint8_t
+{
+    NAV_WALK, // To the tile next to it on the same floor
+    NAV_JUMP, // Jumping with the direction held until it lands
+    NAV_FALL  // Walking off a ledge
+};
+
+struct NavEdge
+{
+    int         from, to;
+    float       cost;      // Seconds from standing on one to standing on the other
+    NavEdgeType type;
+    int8_t      direction; // Movement to hold, -1 left or 1 right
+};
+
+// What NavGraph::steer tells an entity to do this step
+struct NavSteering
+{
+    float direction = 0.0f;
+    bool  jump      = false;
+};
+
+// Where an entity with a given NavPhysics can get to on the map. Nodes are the
+// tiles it can stand on; edges are walks between neighbouring tiles and the
+// jumps and falls found by running a stand-in entity through Entity::update,
+// so they follow the game's own physics and nothing about arcs is worked out
+// while the game runs.
+// Each column keeps its nodes (top to bottom), the edges out of them and the
+// edges into them in a block of its own, so a tile is looked up among the few
+// in its column and an edit only rewrites the blocks of the columns it reaches.
+//
+// Generating it means simulating a few arcs per node, so build() keeps the
+// result in NAV_CACHE_DIRECTORY keyed by a hash of the solid tiles and the
+// physics, and later launches load it instead. Routes to a goal are found
+// backwards from it, once for every node at the same time, and kept for the
+// next NAV_FLOW_FIELDS goals, so every enemy chasing the player shares one search.
+class NavGraph
+{
+private:
+    struct FlowField
+    {
+        int goal = -1;
+        unsigned int last_used = 0;
+        std::vector<float> costs;
+        std::vector<int>   next_edges; // First edge on the way to goal, -1 if it wasn't reached
+    };
+
+    // Where each column's share of an array is. A column that no longer fits
+    // its block moves to a bigger one at the end of the array, leaving the old
+    // one unused, so no other column's indices change.
+    struct ColumnBlocks
+    {
+        std::vector<int> starts, ends, capacities;
+        int count = 0; // In use, over every column
+
+        void reset(int columns)
+        {
+            starts.assign(columns, 0);
+            ends.assign(columns, 0);
+            capacities.assign(columns, 0);
+            count = 0;
+        }
+
+        // Back to back with no room to spare, as the arrays are in the cache
+        void pack(const std::vector<int> &counts)
+        {
+            reset((int) counts.size());
+            for (int column = 0; column < (int) counts.size(); column++)
+            {
+                starts[column]     = count;
+                capacities[column] = counts[column];
+                count             += counts[column];
+                ends[column]       = count;
+            }
+        }
+
+        // Makes column's block hold entries of array, moving it if it has to
+        template <typename T>
+        void fit(std::vector<T> &array, int column, int entries)
+        {
+            count += entries - (ends[column] - starts[column]);
+            if (entries > capacities[column])
+            {
+                starts[column]     = (int) array.size();
+                capacities[column] = entries + entries / 2 + 1;
+                array.resize(array.size() + capacities[column]);
+            }
+            ends[column] = starts[column] + entries;
+        }
+    };
+
+    // Edited columns and those within reach, simulated again an edge at a
+    // time. Until the last one is done, the graph keeps its old edges there.
+    struct Regeneration
+    {
+        std::vector<int>     columns;           // Edited; their nodes are rescanned at the end
+        int                  first_column = 0;  // Everything within m_reach of them
+        int                  last_column  = -1;
+        int                  next_column  = 0;
+        int                  next_row     = 0;
+        int                  next_move    = 0;  // Walk or fall left, jump left, then the same right
+        std::vector<NavEdge> edges;             // From and to are row * width + column until the end
+        std::vector<int>     edge_ends;         // Where each column's edges end, from first_column
+    };
+
+    Map*       m_map = nullptr; // Not const only because Entity::update takes it that way
+    NavPhysics m_physics = {};
+    int        m_reach   = 0; // Columns an arc can carry sideways, so an edit only affects nodes this close
+
+    // Indices into these are what the edges and routes refer to, so they stay put
+    std::vector<glm::ivec2> m_nodes;
+    std::vector<NavEdge>    m_edges;           // Grouped by from, in the column of from
+    std::vector<int>        m_incoming;        // Edge indices grouped by to, in the column of to, for searching backwards
+    std::vector<int>        m_incoming_starts; // Node n's are m_incoming[m_incoming_starts[n]] up to m_incoming_ends[n]
+    std::vector<int>        m_incoming_ends;
+    ColumnBlocks            m_node_blocks;
+    ColumnBlocks            m_edge_blocks;
+    ColumnBlocks            m_incoming_blocks;
+
+    std::vector<int> m_dirty_columns; // Edited since, and not yet part of m_regeneration
+    Regeneration     m_regeneration;  // None while its columns are empty
+
+    FlowField    m_flow_fields[NAV_FLOW_FIELDS];
+    unsigned int m_flow_clock = 0;
+
+    bool const is_standable(int column, int row) const;
+    int  const find_node(glm::ivec2 tile) const;
+    void ground_tiles(glm::vec2 feet, float half_width, glm::ivec2 tiles[3]) const;
+    int  const standing_node(glm::vec2 feet, float half_width) const;
+    int  const node_below(glm::vec3 position) const;
+
+    int  simulate_arc(glm::ivec2 tile, float direction, float vertical_speed, float* airtime) const;
+    void reset();
+    void start_regeneration();
+    bool step_regeneration();
+    void finish_regeneration();
+    void index_edges(int first_column, int last_column);
+    void forget_routes(int first_column, int last_column);
+    void pack(std::vector<glm::ivec2>* nodes, std::vector<NavEdge>* edges) const;
+
+    uint64_t const cache_key() const;
+    bool load_cache(uint64_t key);
+    void save_cache(uint64_t key) const;
+
+    const FlowField &flow_field(int goal);
+
+public:
+    // ————— METHODS ————— //
+    // Loads the graph from the cache, or generates and caches it
+    void build(Map* map, const NavPhysics &physics);
+
+    // Simulates every arc again, whatever is in the cache
+    void generate(Map* map, const NavPhysics &physics);
+
+    // Queues the nodes near the given tiles (e.g. Map::get_changed_tiles) to
+    // be regenerated by update()
+    void update_tiles(const std::vector<glm::ivec2> &tiles);
+
+    // Once a step: regenerates what edits left out of date for up to
+    // NAV_STEP_BUDGET_MS, keeping the old edges wherever it isn't done yet
+    void update();
+
+    // How entity should move this step to get to target along the graph. In
+    // the air it holds the movement it has. False if it isn't standing on the
+    // graph, target is above nothing it can stand on, or there is no route
+    // (that the search could find within its limit).
+    bool steer(const Entity &entity, glm::vec3 target, NavSteering* steering);
+
+    // Seconds it would take entity to get to target along the graph, from the
+    // node it is on (or in the air, the one it will land on). FLT_MAX for
+    // anywhere steer() would give up on.
+    float path_cost(const Entity &entity, glm::vec3 target);
+
+    // ————— GETTERS ————— //
+    int const get_node_count() const { return m_node_blocks.count; }
+    int const get_edge_count() const { return m_edge_blocks.count; }
+    bool const get_is_up_to_date() const { return m_regeneration.columns.empty() && m_dirty_columns.empty(); }
+
+    // Copies without the blocks' spare room, as they are in the cache
+    std::vector<glm::ivec2> const get_nodes() const;
+    std::vector<NavEdge>    const get_edges() const;
+};
+
+// Along nav_graph's route to target if there is one, otherwise straight
+// towards it along x. nav_graph may be null.
+void steer_towards(NavGraph* nav_graph, Entity* entity, glm::vec3 target);
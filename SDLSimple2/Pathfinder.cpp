@@ -0,0 +1,446 @@
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <functional>
+#include <queue>
+#include <tuple>
+#include "Pathfinder.h"
+#include "Profiler.h"
+
+namespace
+{
+    constexpr int CLUSTER_AREA = PATH_CLUSTER_SIZE * PATH_CLUSTER_SIZE;
+
+    const glm::ivec2 STEPS[] = { glm::ivec2(1, 0), glm::ivec2(-1, 0), glm::ivec2(0, 1), glm::ivec2(0, -1) };
+
+    int manhattan(glm::ivec2 a, glm::ivec2 b) { return abs(a.x - b.x) + abs(a.y - b.y); }
+}
+
+bool const Pathfinder::is_open(glm::ivec2 tile) const
+{
+    return tile.x >= 0 && tile.x < m_map->get_width() && tile.y >= 0 && tile.y < m_map->get_height() &&
+           !m_map->is_solid_tile(tile.x, tile.y);
+}
+
+int const Pathfinder::cluster_of(glm::ivec2 tile) const
+{
+    return (tile.y / PATH_CLUSTER_SIZE) * m_cluster_columns + tile.x / PATH_CLUSTER_SIZE;
+}
+
+int const Pathfinder::local_index(glm::ivec2 tile, int cluster) const
+{
+    glm::ivec2 origin = glm::ivec2(cluster % m_cluster_columns, cluster / m_cluster_columns) * PATH_CLUSTER_SIZE;
+    return (tile.y - origin.y) * PATH_CLUSTER_SIZE + (tile.x - origin.x);
+}
+
+// Distances from a tile to the rest of its cluster without leaving it, indexed
+// by local_index and -1 where it cannot reach. Found a row of tiles at a time:
+// each step grows the reached area by one tile in every direction with a few
+// bit operations per row, and a tile's distance is the step it turns up in.
+void Pathfinder::measure_cluster(glm::ivec2 from, int cluster, int* distances) const
+{
+    glm::ivec2 origin = glm::ivec2(cluster % m_cluster_columns, cluster / m_cluster_columns) * PATH_CLUSTER_SIZE;
+    glm::ivec2 size   = glm::min(glm::ivec2(PATH_CLUSTER_SIZE), glm::ivec2(m_map->get_width(), m_map->get_height()) - origin);
+
+    uint32_t open[PATH_CLUSTER_SIZE]    = {},
+             reached[PATH_CLUSTER_SIZE] = {},
+             next[PATH_CLUSTER_SIZE];
+
+    for (int y = 0; y < size.y; y++)
+    {
+        for (int x = 0; x < size.x; x++) open[y] |= (uint32_t) !m_map->is_solid_tile(origin.x + x, origin.y + y) << x;
+    }
+
+    std::fill(distances, distances + CLUSTER_AREA, -1);
+    glm::ivec2 local = from - origin;
+    reached[local.y] = 1u << local.x;
+    distances[local.y * PATH_CLUSTER_SIZE + local.x] = 0;
+
+    for (int distance = 1; ; distance++)
+    {
+        for (int y = 0; y < PATH_CLUSTER_SIZE; y++)
+        {
+            uint32_t row = reached[y] | (reached[y] << 1) | (reached[y] >> 1);
+            if (y > 0)                     row |= reached[y - 1];
+            if (y < PATH_CLUSTER_SIZE - 1) row |= reached[y + 1];
+            next[y] = row & open[y];
+        }
+
+        bool grew = false;
+        for (int y = 0; y < PATH_CLUSTER_SIZE; y++)
+        {
+            uint32_t added = next[y] & ~reached[y];
+            grew |= added != 0;
+
+            for (; added != 0; added &= added - 1) distances[y * PATH_CLUSTER_SIZE + std::countr_zero(added)] = distance;
+            reached[y] = next[y];
+        }
+        if (!grew) break;
+    }
+}
+
+// Breadth-first from a tile without leaving its cluster, for the route as well
+// as the distances (see measure_cluster); parents are indexed the same way.
+void Pathfinder::search_cluster(glm::ivec2 from, int cluster, int* distances, int* parents) const
+{
+    glm::ivec2 origin = glm::ivec2(cluster % m_cluster_columns, cluster / m_cluster_columns) * PATH_CLUSTER_SIZE;
+    glm::ivec2 end    = glm::min(origin + PATH_CLUSTER_SIZE, glm::ivec2(m_map->get_width(), m_map->get_height()));
+
+    std::fill(distances, distances + CLUSTER_AREA, -1);
+
+    int queue[CLUSTER_AREA];
+    int head = 0, tail = 0;
+
+    int start = local_index(from, cluster);
+    distances[start] = 0;
+    parents[start]   = -1;
+    queue[tail++]    = start;
+
+    while (head < tail)
+    {
+        int index = queue[head++];
+        glm::ivec2 tile = origin + glm::ivec2(index % PATH_CLUSTER_SIZE, index / PATH_CLUSTER_SIZE);
+
+        for (glm::ivec2 step : STEPS)
+        {
+            glm::ivec2 next = tile + step;
+            if (next.x < origin.x || next.y < origin.y || next.x >= end.x || next.y >= end.y) continue;
+
+            int next_index = index + step.y * PATH_CLUSTER_SIZE + step.x;
+            if (distances[next_index] >= 0 || m_map->is_solid_tile(next.x, next.y)) continue;
+
+            distances[next_index] = distances[index] + 1;
+            parents[next_index]   = index;
+            queue[tail++]         = next_index;
+        }
+    }
+}
+
+void Pathfinder::add_entrance(glm::ivec2 inside, glm::ivec2 outside, int border)
+{
+    auto allocate = [this]
+    {
+        if (m_free_nodes.empty())
+        {
+            m_nodes.emplace_back();
+            return (int) m_nodes.size() - 1;
+        }
+        int node = m_free_nodes.back();
+        m_free_nodes.pop_back();
+        return node;
+    };
+
+    int a = allocate();
+    int b = allocate();
+    glm::ivec2 tiles[] = { inside, outside };
+    int        nodes[] = { a, b };
+
+    for (int side = 0; side < 2; side++)
+    {
+        Node &node = m_nodes[nodes[side]];
+        node.tile    = tiles[side];
+        node.cluster = cluster_of(tiles[side]);
+        node.partner = nodes[1 - side];
+        node.edges.clear();
+
+        m_cluster_nodes[node.cluster].push_back(nodes[side]);
+        m_border_nodes[border].push_back(nodes[side]);
+    }
+}
+
+// One entrance in the middle of every open stretch of the border, or one at
+// each end of long ones
+void Pathfinder::scan_border(int border)
+{
+    int  cluster  = border / 2;
+    bool is_right = border % 2 == 0;
+    int  column   = cluster % m_cluster_columns,
+         row      = cluster / m_cluster_columns;
+
+    if (is_right ? column == m_cluster_columns - 1 : row == m_cluster_rows - 1) return;
+
+    glm::ivec2 origin = glm::ivec2(column, row) * PATH_CLUSTER_SIZE;
+    glm::ivec2 across = is_right ? glm::ivec2(1, 0) : glm::ivec2(0, 1);
+    glm::ivec2 along  = is_right ? glm::ivec2(0, 1) : glm::ivec2(1, 0);
+    glm::ivec2 first  = origin + (PATH_CLUSTER_SIZE - 1) * across;
+    int length = std::min(PATH_CLUSTER_SIZE, is_right ? m_map->get_height() - origin.y : m_map->get_width() - origin.x);
+
+    int run_start = -1;
+    for (int i = 0; i <= length; i++)
+    {
+        glm::ivec2 tile = first + i * along;
+        bool open = i < length && is_open(tile) && is_open(tile + across);
+
+        if (open && run_start < 0) run_start = i;
+        if (open || run_start < 0) continue;
+
+        int run_end = i - 1;
+        if (run_end - run_start + 1 < PATH_ENTRANCE_SPLIT)
+        {
+            glm::ivec2 middle = first + ((run_start + run_end) / 2) * along;
+            add_entrance(middle, middle + across, border);
+        }
+        else
+        {
+            add_entrance(first + run_start * along, first + run_start * along + across, border);
+            add_entrance(first + run_end * along,   first + run_end * along + across,   border);
+        }
+        run_start = -1;
+    }
+}
+
+void Pathfinder::free_border(int border)
+{
+    for (int index : m_border_nodes[border])
+    {
+        Node &node = m_nodes[index];
+        std::vector<int> &cluster_nodes = m_cluster_nodes[node.cluster];
+        cluster_nodes.erase(std::find(cluster_nodes.begin(), cluster_nodes.end(), index));
+
+        node.edges.clear();
+        m_free_nodes.push_back(index);
+    }
+    m_border_nodes[border].clear();
+}
+
+// Links every pair of the cluster's nodes that can reach each other inside it
+void Pathfinder::connect_cluster(int cluster)
+{
+    int distances[CLUSTER_AREA];
+    const std::vector<int> &nodes = m_cluster_nodes[cluster];
+
+    for (int a : nodes)
+    {
+        Node &node = m_nodes[a];
+        node.edges.clear();
+        measure_cluster(node.tile, cluster, distances);
+
+        for (int b : nodes)
+        {
+            int distance = distances[local_index(m_nodes[b].tile, cluster)];
+            if (b != a && distance >= 0) node.edges.push_back({ b, distance });
+        }
+    }
+}
+
+void Pathfinder::build(const Map* map)
+{
+    PROFILE_ZONE("Pathfinder::build");
+
+    m_map = map;
+    m_cluster_columns = (map->get_width()  + PATH_CLUSTER_SIZE - 1) / PATH_CLUSTER_SIZE;
+    m_cluster_rows    = (map->get_height() + PATH_CLUSTER_SIZE - 1) / PATH_CLUSTER_SIZE;
+
+    m_nodes.clear();
+    m_free_nodes.clear();
+    m_cluster_nodes.assign(get_cluster_count(), std::vector<int>());
+    m_border_nodes.assign(get_cluster_count() * 2, std::vector<int>());
+
+    for (int border = 0; border < get_cluster_count() * 2; border++) scan_border(border);
+    for (int cluster = 0; cluster < get_cluster_count(); cluster++) connect_cluster(cluster);
+}
+
+// A tile inside a cluster only changes the paths through it; one on a
+// cluster's edge also moves the entrances across that border, which changes
+// the clusters either side
+void Pathfinder::update_tiles(const std::vector<glm::ivec2> &tiles)
+{
+    if (tiles.empty()) return;
+    PROFILE_ZONE("Pathfinder::update_tiles");
+
+    std::vector<int> clusters, borders;
+    for (glm::ivec2 tile : tiles)
+    {
+        if (tile.x < 0 || tile.x >= m_map->get_width() || tile.y < 0 || tile.y >= m_map->get_height()) continue;
+
+        int cluster = cluster_of(tile);
+        glm::ivec2 local = tile % PATH_CLUSTER_SIZE;
+        clusters.push_back(cluster);
+
+        if (local.x == PATH_CLUSTER_SIZE - 1) borders.push_back(2 * cluster);
+        if (local.x == 0 && tile.x > 0)       borders.push_back(2 * (cluster - 1));
+        if (local.y == PATH_CLUSTER_SIZE - 1) borders.push_back(2 * cluster + 1);
+        if (local.y == 0 && tile.y > 0)       borders.push_back(2 * (cluster - m_cluster_columns) + 1);
+    }
+
+    std::sort(borders.begin(), borders.end());
+    borders.erase(std::unique(borders.begin(), borders.end()), borders.end());
+
+    for (int border : borders)
+    {
+        int  cluster  = border / 2;
+        bool is_right = border % 2 == 0;
+        if (is_right ? cluster % m_cluster_columns == m_cluster_columns - 1 : cluster / m_cluster_columns == m_cluster_rows - 1) continue;
+
+        free_border(border);
+        scan_border(border);
+        clusters.push_back(cluster);
+        clusters.push_back(is_right ? cluster + 1 : cluster + m_cluster_columns);
+    }
+
+    std::sort(clusters.begin(), clusters.end());
+    clusters.erase(std::unique(clusters.begin(), clusters.end()), clusters.end());
+
+    for (int cluster : clusters) connect_cluster(cluster);
+}
+
+bool Pathfinder::find_path(glm::ivec2 start, glm::ivec2 goal, Path* path)
+{
+    PROFILE_ZONE("Pathfinder::find_path");
+
+    path->waypoints.clear();
+    path->cost        = 0;
+    path->is_complete = false;
+    if (!is_open(start) || !is_open(goal)) return false;
+
+    int start_cluster = cluster_of(start),
+        goal_cluster  = cluster_of(goal);
+
+    int start_distances[CLUSTER_AREA],
+        goal_distances[CLUSTER_AREA];
+    measure_cluster(start, start_cluster, start_distances);
+
+    // Inside one cluster the local search already has the answer
+    if (start_cluster == goal_cluster && start_distances[local_index(goal, goal_cluster)] >= 0)
+    {
+        path->waypoints.push_back(start);
+        if (goal != start) path->waypoints.push_back(goal);
+        path->cost        = start_distances[local_index(goal, goal_cluster)];
+        path->is_complete = true;
+        return true;
+    }
+    measure_cluster(goal, goal_cluster, goal_distances);
+
+    if (m_stamps.size() < m_nodes.size())
+    {
+        m_costs.resize(m_nodes.size());
+        m_parents.resize(m_nodes.size());
+        m_is_closed.resize(m_nodes.size());
+        m_stamps.resize(m_nodes.size(), 0);
+    }
+    if (++m_search_stamp == 0)
+    {
+        std::fill(m_stamps.begin(), m_stamps.end(), 0);
+        m_search_stamp = 1;
+    }
+
+    // Overestimating a little keeps the search heading for the goal instead of
+    // fanning out over every node as short as the best path (on a grid, most
+    // of them), for paths a few percent longer. Nodes are never expanded twice,
+    // which keeps that bound and the search limit meaningful.
+    auto estimate_to_goal = [goal](glm::ivec2 tile) { return (int) (PATH_HEURISTIC_WEIGHT * manhattan(tile, goal)); };
+
+    // Smallest estimate first and, among equal estimates, the furthest along.
+    // Stale entries are left in and skipped when they come up.
+    using Entry = std::tuple<int, int, int>; // estimate, -cost, node
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+    auto reach = [&](int node, int cost, int parent)
+    {
+        if (m_stamps[node] == m_search_stamp && (m_costs[node] <= cost || m_is_closed[node])) return;
+
+        m_stamps[node]  = m_search_stamp;
+        m_costs[node]   = cost;
+        m_parents[node] = parent;
+        m_is_closed[node] = false;
+        open.push(Entry(cost + estimate_to_goal(m_nodes[node].tile), -cost, node));
+    };
+
+    for (int node : m_cluster_nodes[start_cluster])
+    {
+        int distance = start_distances[local_index(m_nodes[node].tile, start_cluster)];
+        if (distance >= 0) reach(node, distance, -1);
+    }
+
+    int best_cost    = INT_MAX,
+        best_node    = -1,
+        nearest_node = -1, // Of those expanded, the one closest to the goal
+        expanded     = 0;
+    while (!open.empty() && expanded < PATH_SEARCH_LIMIT)
+    {
+        auto [estimate, negative_cost, node] = open.top();
+        open.pop();
+
+        if (estimate >= best_cost) break;
+        if (-negative_cost != m_costs[node] || m_is_closed[node]) continue;
+
+        const Node &current = m_nodes[node];
+        int cost = m_costs[node];
+        m_is_closed[node] = true;
+        expanded++;
+
+        if (nearest_node < 0 || manhattan(current.tile, goal) < manhattan(m_nodes[nearest_node].tile, goal)) nearest_node = node;
+
+        if (current.cluster == goal_cluster)
+        {
+            int distance = goal_distances[local_index(current.tile, goal_cluster)];
+            if (distance >= 0 && cost + distance < best_cost)
+            {
+                best_cost = cost + distance;
+                best_node = node;
+            }
+        }
+
+        reach(current.partner, cost + 1, node);
+        for (const Edge &edge : current.edges) reach(edge.to, cost + edge.cost, node);
+    }
+    // Out of budget before reaching the goal: the way to wherever got closest
+    path->is_complete = best_node >= 0;
+    if (!path->is_complete)
+    {
+        if (open.empty() || nearest_node < 0) return false;
+
+        best_node = nearest_node;
+        best_cost = m_costs[nearest_node];
+    }
+    else
+    {
+        path->waypoints.push_back(goal);
+    }
+
+    for (int node = best_node; node >= 0; node = m_parents[node])
+    {
+        // Entrances on two borders at once are two nodes on the same tile
+        if (path->waypoints.empty() || m_nodes[node].tile != path->waypoints.back()) path->waypoints.push_back(m_nodes[node].tile);
+    }
+    if (start != path->waypoints.back()) path->waypoints.push_back(start);
+
+    std::reverse(path->waypoints.begin(), path->waypoints.end());
+    path->cost = best_cost;
+    return true;
+}
+
+bool Pathfinder::refine_segment(const Path &path, int segment, std::vector<glm::ivec2>* tiles) const
+{
+    tiles->clear();
+    if (segment < 0 || segment + 1 >= (int) path.waypoints.size()) return false;
+
+    glm::ivec2 from = path.waypoints[segment],
+               to   = path.waypoints[segment + 1];
+
+    // Across a border, or any other single step
+    if (manhattan(from, to) == 1)
+    {
+        tiles->push_back(to);
+        return is_open(to);
+    }
+
+    int cluster = cluster_of(from);
+    if (cluster_of(to) != cluster) return false;
+
+    int distances[CLUSTER_AREA],
+        parents[CLUSTER_AREA];
+    search_cluster(from, cluster, distances, parents);
+
+    // Unreachable if the map has changed since the path was found
+    int index = local_index(to, cluster);
+    if (distances[index] < 0) return false;
+
+    glm::ivec2 origin = glm::ivec2(cluster % m_cluster_columns, cluster / m_cluster_columns) * PATH_CLUSTER_SIZE;
+    tiles->resize(distances[index]);
+    for (int i = distances[index] - 1; i >= 0; i--, index = parents[index])
+    {
+        (*tiles)[i] = origin + glm::ivec2(index % PATH_CLUSTER_SIZE, index / PATH_CLUSTER_SIZE);
+    }
+    return true;
+}
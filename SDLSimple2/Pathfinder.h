@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "Map.h"
+
+constexpr int   PATH_CLUSTER_SIZE     = 16;    // Tiles along each side of a cluster
+constexpr int   PATH_ENTRANCE_SPLIT   = 6;     // Open stretches of border this long get an entrance at each end instead of one in the middle
+constexpr float PATH_HEURISTIC_WEIGHT = 1.25f; // Trades a few percent of path length for far fewer nodes searched
+constexpr int   PATH_SEARCH_LIMIT     = 1024; // Nodes expanded per query, so its cost doesn't grow with the level
+
+// What Pathfinder::find_path returns: the tiles where the path enters and
+// leaves each cluster, from start to goal, in tile coordinates (column, row).
+// The tiles in between are filled in with refine_segment as they are needed.
+// A goal further than the search limit reaches gives an incomplete path, to
+// the tile it got closest to, to follow before asking again from its end.
+struct Path
+{
+    std::vector<glm::ivec2> waypoints;
+    int  cost        = 0; // Steps from tile to tile
+    bool is_complete = false;
+};
+
+// Hierarchical A* (HPA*) over the map's open tiles, moving up, down, left
+// and right. The map is cut into PATH_CLUSTER_SIZE square clusters; wherever
+// two clusters share open border there is an entrance, a pair of nodes one
+// either side, and the nodes of each cluster are linked by the length of the
+// shortest path between them inside it. A query only searches that graph, so
+// its cost follows the number of clusters crossed rather than tiles, and is
+// capped by PATH_SEARCH_LIMIT.
+// Changing tiles only rebuilds the clusters and borders they touch.
+//
+// Paths ignore gravity, so they can't drive a platformer entity; the game's
+// enemies steer along NavGraph instead and nothing in GameState builds one.
+// It is kept as a library for searches over open tiles, and tools/benchmark
+// keeps it measured.
+class Pathfinder
+{
+private:
+    struct Edge
+    {
+        int to;
+        int cost;
+    };
+
+    struct Node
+    {
+        glm::ivec2 tile;
+        int cluster;
+        int partner;             // The node across the border, one step away
+        std::vector<Edge> edges; // To the other nodes of its cluster
+    };
+
+    const Map* m_map = nullptr;
+    int m_cluster_columns = 0,
+        m_cluster_rows    = 0;
+
+    std::vector<Node> m_nodes;
+    std::vector<int>  m_free_nodes; // Left by entrances that have gone, for reuse
+    std::vector<std::vector<int>> m_cluster_nodes;
+    std::vector<std::vector<int>> m_border_nodes; // Border 2c is cluster c's right edge, 2c + 1 its bottom edge
+
+    // ————— SEARCH SCRATCH ————— //
+    // A node's cost and parent are only valid where its stamp is the current search's
+    std::vector<int>      m_costs;
+    std::vector<int>      m_parents;
+    std::vector<uint8_t>  m_is_closed;
+    std::vector<unsigned> m_stamps;
+    unsigned m_search_stamp = 0;
+
+    bool const is_open(glm::ivec2 tile) const;
+    int  const cluster_of(glm::ivec2 tile) const;
+    int  const local_index(glm::ivec2 tile, int cluster) const;
+
+    void measure_cluster(glm::ivec2 from, int cluster, int* distances) const;
+    void search_cluster(glm::ivec2 from, int cluster, int* distances, int* parents) const;
+    void add_entrance(glm::ivec2 inside, glm::ivec2 outside, int border);
+    void scan_border(int border);
+    void free_border(int border);
+    void connect_cluster(int cluster);
+
+public:
+    // ————— METHODS ————— //
+    void build(const Map* map);
+
+    // Rebuilds whatever the given tiles (e.g. Map::get_changed_tiles) may have changed
+    void update_tiles(const std::vector<glm::ivec2> &tiles);
+
+    // False if either end is solid or there is no way through (that the
+    // search could tell within its limit)
+    bool find_path(glm::ivec2 start, glm::ivec2 goal, Path* path);
+
+    // The tiles after waypoint segment up to and including waypoint segment + 1
+    bool refine_segment(const Path &path, int segment, std::vector<glm::ivec2>* tiles) const;
+
+    // ————— GETTERS ————— //
+    int const get_node_count()    const { return (int) (m_nodes.size() - m_free_nodes.size()); }
+    int const get_cluster_count() const { return m_cluster_columns * m_cluster_rows;            }
+};
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cmath>
+#include "Perception.h"
+#include "Entity.h"
+#include "Profiler.h"
+
+bool const Percept::nearest_disturbance(glm::vec3* position) const
+{
+    int nearest = -1;
+    for (int type = STIMULUS_NOISE; type < STIMULUS_TYPE_COUNT; type++)
+    {
+        if (senses[type] && (nearest < 0 || distances[type] < distances[nearest])) nearest = type;
+    }
+    if (nearest < 0) return false;
+
+    *position = positions[nearest];
+    return true;
+}
+
+void Perception::add_stimulus(const Stimulus &stimulus)
+{
+    m_stimuli.push_back(stimulus);
+    m_stimuli.back().radius = std::min(stimulus.radius, PERCEPTION_RANGE);
+}
+
+void Perception::clear()
+{
+    m_stimuli.clear();
+}
+
+glm::ivec2 const Perception::cell_of(glm::vec3 position) const
+{
+    int column = (int) std::floor((position.x - m_left_bound) / PERCEPTION_RANGE);
+    int row    = (int) std::floor((m_top_bound - position.y) / PERCEPTION_RANGE);
+    return glm::ivec2(glm::clamp(column, 0, m_cell_columns - 1), glm::clamp(row, 0, m_cell_rows - 1));
+}
+
+// Counting sort of the stimuli by cell. Filling from the back turns each
+// cell's running total back into its start, so no second array is needed.
+void Perception::build_index(const Map* map)
+{
+    m_left_bound   = map->get_left_bound();
+    m_top_bound    = map->get_top_bound();
+    m_cell_columns = std::max(1, (int) std::ceil((map->get_right_bound() - m_left_bound) / PERCEPTION_RANGE));
+    m_cell_rows    = std::max(1, (int) std::ceil((m_top_bound - map->get_bottom_bound()) / PERCEPTION_RANGE));
+
+    int cell_count     = m_cell_columns * m_cell_rows;
+    int stimulus_count = get_stimulus_count();
+
+    m_cell_starts.assign(cell_count + 1, 0);
+    m_stimulus_cells.resize(stimulus_count);
+    m_cell_stimuli.resize(stimulus_count);
+
+    for (int i = 0; i < stimulus_count; i++)
+    {
+        glm::ivec2 cell = cell_of(m_stimuli[i].position);
+        m_stimulus_cells[i] = cell.y * m_cell_columns + cell.x;
+        m_cell_starts[m_stimulus_cells[i]]++;
+    }
+    for (int cell = 1; cell <= cell_count; cell++) m_cell_starts[cell] += m_cell_starts[cell - 1];
+    for (int i = stimulus_count - 1; i >= 0; i--) m_cell_stimuli[--m_cell_starts[m_stimulus_cells[i]]] = i;
+}
+
+// Nearest stimulus of each type within reach of the agent. Cells are as wide
+// as the furthest anything carries, so the neighbouring cells are enough.
+void Perception::sense(Entity* agent, Percept* percept) const
+{
+    glm::vec2  position = glm::vec2(agent->get_position());
+    glm::ivec2 cell     = cell_of(agent->get_position());
+
+    for (bool &senses : percept->senses) senses = false;
+
+    for (int row = std::max(cell.y - 1, 0); row <= std::min(cell.y + 1, m_cell_rows - 1); row++)
+    {
+        for (int column = std::max(cell.x - 1, 0); column <= std::min(cell.x + 1, m_cell_columns - 1); column++)
+        {
+            int index = row * m_cell_columns + column;
+            for (int i = m_cell_starts[index]; i < m_cell_starts[index + 1]; i++)
+            {
+                const Stimulus &stimulus = m_stimuli[m_cell_stimuli[i]];
+                if (stimulus.source == agent) continue;
+
+                float distance = glm::distance(position, glm::vec2(stimulus.position));
+                if (distance >= stimulus.radius) continue;
+                if (percept->senses[stimulus.type] && distance >= percept->distances[stimulus.type]) continue;
+
+                percept->senses[stimulus.type]    = true;
+                percept->distances[stimulus.type] = distance;
+                percept->positions[stimulus.type] = stimulus.position;
+            }
+        }
+    }
+}
+
+void Perception::update(float delta_time, Entity* agents, int agent_count, const Map* map, unsigned int step)
+{
+    PROFILE_ZONE("perception");
+    build_index(map);
+
+    m_sight_agents.clear();
+    m_sight_rays.clear();
+
+    for (int i = 0; i < agent_count; i++)
+    {
+        Entity* agent = &agents[i];
+        if ((step + i) % PERCEPTION_INTERVAL != 0 || !agent->get_is_active() || agent->get_is_sleeping()) continue;
+
+        Percept percept = agent->get_percept();
+        sense(agent, &percept);
+
+        // Whether it can see the player waits for the batched raycast below
+        float distance = percept.distances[STIMULUS_PLAYER];
+        percept.can_see_player = percept.senses[STIMULUS_PLAYER] && distance == 0.0f;
+
+        if (percept.senses[STIMULUS_PLAYER] && distance > 0.0f)
+        {
+            glm::vec2 position = glm::vec2(agent->get_position());
+            glm::vec2 offset   = glm::vec2(percept.positions[STIMULUS_PLAYER]) - position;
+            m_sight_rays.push_back({ position, offset / distance, distance });
+            m_sight_agents.push_back(agent);
+        }
+        agent->set_percept(percept);
+    }
+
+    m_sight_hits.resize(m_sight_rays.size());
+    map->raycast(m_sight_rays.data(), (int) m_sight_rays.size(), m_sight_hits.data());
+
+    for (int ray = 0; ray < (int) m_sight_rays.size(); ray++)
+    {
+        m_sight_agents[ray]->set_can_see_player(!m_sight_hits[ray].hit);
+    }
+
+    // Aged last, so whatever was added for this step has been sensed once
+    for (Stimulus &stimulus : m_stimuli) stimulus.time_left -= delta_time;
+    m_stimuli.erase(std::remove_if(m_stimuli.begin(), m_stimuli.end(),
+                                   [](const Stimulus &stimulus) { return stimulus.time_left < 0.0f; }),
+                    m_stimuli.end());
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+#include "glm/glm.hpp"
+#include "Map.h"
+
+class Entity;
+
+// Things an agent can notice. It only keeps the nearest one of each type.
+enum StimulusType
+{
+    STIMULUS_PLAYER,     // Where the player is, registered again every step
+    STIMULUS_NOISE,      // The player jumping
+    STIMULUS_ALLY_DEATH, // An enemy being killed
+    STIMULUS_TYPE_COUNT
+};
+
+struct Stimulus
+{
+    StimulusType  type;
+    glm::vec3     position;
+    float         radius;              // Sensed closer than this, capped at PERCEPTION_RANGE
+    float         time_left = 0.0f;    // Seconds it outlives the step it was added in
+    const Entity* source    = nullptr; // Never senses its own stimuli
+};
+
+// What an agent last perceived, in place of reading other entities directly.
+// Positions outlive the stimulus, so it still knows where it last sensed each
+// type after losing it.
+struct Percept
+{
+    bool      senses[STIMULUS_TYPE_COUNT]    = {};
+    float     distances[STIMULUS_TYPE_COUNT] = {}; // Only while sensed
+    glm::vec3 positions[STIMULUS_TYPE_COUNT] = {};
+    bool      can_see_player = false;              // Sensed and nothing solid in between
+
+    // The nearer of a sensed noise or ally death, worth a look; false if neither
+    bool const nearest_disturbance(glm::vec3* position) const;
+};
+
+constexpr float PERCEPTION_RANGE    = 10.0f; // Furthest any stimulus carries
+constexpr int   PERCEPTION_INTERVAL = 3;     // Steps between refreshes of one agent's percept
+
+// Stimuli are registered here instead of agents looking at the player (or
+// each other) themselves. Every update re-indexes them in a grid of cells
+// PERCEPTION_RANGE wide, so an agent only checks the stimuli in its own cell
+// and the eight around it, and refreshes a third of the agents, staggered by
+// index, so the queries and the sight raycasts they need are spread out over
+// PERCEPTION_INTERVAL steps. Agents read the result from Entity::get_percept.
+class Perception
+{
+private:
+    std::vector<Stimulus> m_stimuli;
+
+    // ————— SPATIAL INDEX ————— //
+    // Cell c holds m_cell_stimuli[m_cell_starts[c]] up to m_cell_starts[c + 1].
+    // Anything off the map is counted in the nearest edge cell.
+    int m_cell_columns = 0,
+        m_cell_rows    = 0;
+    float m_left_bound = 0.0f,
+          m_top_bound  = 0.0f;
+    std::vector<int> m_cell_starts;
+    std::vector<int> m_cell_stimuli;
+    std::vector<int> m_stimulus_cells;
+
+    // ————— BATCH SCRATCH ————— //
+    // Sight lines of the agents refreshed this update, raycast together
+    std::vector<Entity*> m_sight_agents;
+    std::vector<Ray>     m_sight_rays;
+    std::vector<RayHit>  m_sight_hits;
+
+    glm::ivec2 const cell_of(glm::vec3 position) const;
+    void build_index(const Map* map);
+    void sense(Entity* agent, Percept* percept) const;
+
+public:
+    // ————— METHODS ————— //
+    void add_stimulus(const Stimulus &stimulus);
+    void clear();
+
+    // Drops stimuli that have run out, indexes the rest and refreshes the
+    // percepts of the agents whose turn it is this step
+    void update(float delta_time, Entity* agents, int agent_count, const Map* map, unsigned int step);
+
+    // ————— GETTERS ————— //
+    int const get_stimulus_count() const { return (int) m_stimuli.size(); }
+};
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include "Profiler.h"
+
+// Per-thread ring; must be a power of two. Zones past this many in one
+// frame on one thread are dropped (and counted) rather than blocking.
+constexpr uint32_t RING_CAPACITY = 4096;
+constexpr uint32_t RING_MASK     = RING_CAPACITY - 1;
+
+// Upper bound on a capture so leaving it running cannot eat all memory
+constexpr size_t MAX_CAPTURED_EVENTS = 1 << 20;
+
+struct ThreadRing
+{
+    ZoneEvent             events[RING_CAPACITY];
+    std::atomic<uint32_t> head { 0 }; // Only the owning thread writes this...
+    std::atomic<uint32_t> tail { 0 }; // ...and only end_frame() writes this
+    uint32_t              thread_index = 0;
+};
+
+// Rings outlive their threads so a zone recorded just before a thread exits is not lost
+static std::mutex                               s_rings_mutex;
+static std::vector<std::unique_ptr<ThreadRing>> s_rings;
+
+static std::vector<ZoneSummary> s_frame_summary;
+static std::vector<ZoneSummary> s_building_summary;
+static std::vector<ZoneEvent>   s_capture;
+static bool                     s_capturing = false;
+static std::atomic<uint32_t>    s_dropped { 0 };
+
+static uint64_t s_frame_start_ns = 0;
+static double   s_frame_ms       = 0.0;
+
+static ThreadRing* thread_ring()
+{
+    // Registration is the only locked step, and happens once per thread
+    thread_local ThreadRing* ring = nullptr;
+    if (ring == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(s_rings_mutex);
+        s_rings.push_back(std::make_unique<ThreadRing>());
+        ring = s_rings.back().get();
+        ring->thread_index = (uint32_t) s_rings.size() - 1;
+    }
+    return ring;
+}
+
+uint64_t profiler::now_ns()
+{
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t &profiler::thread_depth()
+{
+    thread_local uint32_t depth = 0;
+    return depth;
+}
+
+// Always goes through the caller's ring, even when labelled with another track
+void profiler::record(const char* name, uint64_t start_ns, uint64_t end_ns, uint32_t depth, uint32_t track)
+{
+    ThreadRing* ring = thread_ring();
+    if (track == CALLING_THREAD_TRACK) track = ring->thread_index;
+
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= RING_CAPACITY)
+    {
+        s_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    ring->events[head & RING_MASK] = { name, start_ns, end_ns, depth, track };
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void profiler::begin_frame()
+{
+    s_frame_start_ns = now_ns();
+}
+
+static void add_to_summary(const ZoneEvent &event)
+{
+    double ms = (event.end_ns - event.start_ns) / 1000000.0;
+
+    for (ZoneSummary &summary : s_building_summary)
+    {
+        if (summary.name == event.name || std::strcmp(summary.name, event.name) == 0)
+        {
+            summary.calls++;
+            summary.total_ms += ms;
+            if (event.depth < summary.depth) summary.depth = event.depth;
+            if (event.start_ns < summary.first_start_ns) summary.first_start_ns = event.start_ns;
+            return;
+        }
+    }
+    s_building_summary.push_back({ event.name, event.depth, 1, ms, event.start_ns });
+}
+
+void profiler::end_frame()
+{
+    s_building_summary.clear();
+
+    std::lock_guard<std::mutex> lock(s_rings_mutex);
+    for (std::unique_ptr<ThreadRing> &ring : s_rings)
+    {
+        uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint32_t head = ring->head.load(std::memory_order_acquire);
+
+        for (; tail != head; tail++)
+        {
+            const ZoneEvent &event = ring->events[tail & RING_MASK];
+            add_to_summary(event);
+            if (s_capturing && s_capture.size() < MAX_CAPTURED_EVENTS) s_capture.push_back(event);
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+
+    // Zones finish inner-first; list them by start of their first call instead
+    std::sort(s_building_summary.begin(), s_building_summary.end(),
+              [](const ZoneSummary &a, const ZoneSummary &b) { return a.first_start_ns < b.first_start_ns; });
+    s_frame_summary.swap(s_building_summary);
+    s_frame_ms = (now_ns() - s_frame_start_ns) / 1000000.0;
+}
+
+void profiler::start_capture()
+{
+    s_capture.clear();
+    s_capturing = true;
+}
+
+bool profiler::write_chrome_trace(const char* filepath)
+{
+    s_capturing = false;
+
+    FILE* file = std::fopen(filepath, "w");
+    if (file == NULL) return false;
+
+    // Complete ("X") events in microseconds, one track per recording thread
+    uint64_t origin_ns = s_capture.empty() ? 0 : s_capture.front().start_ns;
+    for (const ZoneEvent &event : s_capture) if (event.start_ns < origin_ns) origin_ns = event.start_ns;
+
+    std::fprintf(file, "{\"traceEvents\":[\n");
+    std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"GPU\"}}", GPU_TRACK);
+    for (size_t i = 0; i < s_capture.size(); i++)
+    {
+        const ZoneEvent &event = s_capture[i];
+        std::fprintf(file, ",\n{\"name\":\"");
+        for (const char* c = event.name; *c != '\0'; c++)
+        {
+            if (*c == '"' || *c == '\\') std::fputc('\\', file);
+            std::fputc(*c, file);
+        }
+        std::fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                     event.thread_index,
+                     (event.start_ns - origin_ns) / 1000.0,
+                     (event.end_ns - event.start_ns) / 1000.0);
+    }
+    std::fprintf(file, "\n]}\n");
+    std::fclose(file);
+
+    s_capture.clear();
+    return true;
+}
+
+std::vector<ZoneSummary> const &profiler::get_frame_summary() { return s_frame_summary; }
+double   const profiler::get_frame_ms()       { return s_frame_ms; }
+uint32_t const profiler::get_dropped_events() { return s_dropped.load(std::memory_order_relaxed); }
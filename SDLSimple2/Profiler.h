@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Set to 0 (e.g. -DENABLE_PROFILER=0) to compile every PROFILE_ZONE out entirely
+#ifndef ENABLE_PROFILER
+#define ENABLE_PROFILER 1
+#endif
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if ENABLE_PROFILER
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name)
+#endif
+
+// One finished zone. Names must be string literals (or otherwise outlive the profiler).
+struct ZoneEvent
+{
+    const char* name;
+    uint64_t    start_ns;
+    uint64_t    end_ns;
+    uint32_t    depth;
+    uint32_t    thread_index;
+};
+
+// Time spent in one zone name over the last completed frame
+struct ZoneSummary
+{
+    const char* name;
+    uint32_t    depth;
+    uint32_t    calls;
+    double      total_ms;
+    uint64_t    first_start_ns;
+};
+
+// Hierarchical CPU profiler. Each thread writes finished zones into its own
+// single-producer ring, so recording a zone never takes a lock; end_frame()
+// on the main thread drains every ring into the per-frame summary and, while
+// capturing, into a trace that write_chrome_trace() saves for chrome://tracing.
+namespace profiler
+{
+    // Trace track for events that did not run on a CPU thread, e.g. GPU passes
+    constexpr uint32_t GPU_TRACK = 0xFFFF;
+    // Stands for the track of whichever thread records the event
+    constexpr uint32_t CALLING_THREAD_TRACK = 0xFFFFFFFF;
+
+    uint64_t now_ns();
+    void     record(const char* name, uint64_t start_ns, uint64_t end_ns, uint32_t depth,
+                    uint32_t track = CALLING_THREAD_TRACK);
+
+    void begin_frame();
+    void end_frame();
+
+    void start_capture();
+    bool write_chrome_trace(const char* filepath);
+
+    std::vector<ZoneSummary> const &get_frame_summary();
+    double   const get_frame_ms();
+    uint32_t const get_dropped_events();
+
+    // Zone nesting depth of the calling thread
+    uint32_t &thread_depth();
+}
+
+class ProfileZone
+{
+private:
+    const char* m_name;
+    uint64_t    m_start_ns;
+
+public:
+    ProfileZone(const char* name) : m_name(name), m_start_ns(profiler::now_ns())
+    {
+        profiler::thread_depth()++;
+    }
+
+    ~ProfileZone()
+    {
+        uint32_t depth = --profiler::thread_depth();
+        profiler::record(m_name, m_start_ns, profiler::now_ns(), depth);
+    }
+};
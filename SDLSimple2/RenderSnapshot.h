@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+#include "Entity.h"
+
+// What the simulation thread published after its latest batch of fixed steps.
+// The render thread only ever draws from one of these, never from the live
+// GameState. Besides the TripleBuffer, the only thing the threads share is the
+// Map object: the render thread owns its vertices and texture coordinates
+// (rebuilt from map_tiles below), and only reads what the constructor set and
+// nothing changes afterwards, e.g. its bounds, tile size and texture.
+struct RenderSnapshot
+{
+    std::vector<SpriteInstance> sprites; // The player first, then every active enemy
+    int   enemies_remaining = 0;
+    bool  waves_finished    = false; // No more enemies to come
+    bool  lose_game         = false;
+
+    // The level data as of map_revision. Slots are reused, so it is only copied
+    // again into a slot that is behind the map, at most once per slot per edit.
+    std::vector<unsigned int> map_tiles;
+    unsigned int              map_revision = 0; // 0 is the level as loaded
+
+    // Lets the renderer work out how far past the last step it is drawing
+    float published_ticks = 0.0f; // Seconds since startup when it was published
+    float accumulator     = 0.0f; // Time not yet simulated at that moment
+};
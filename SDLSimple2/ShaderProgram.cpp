@@ -1,38 +1,185 @@
 #define GL_SILENCE_DEPRECATION
 
+#include <filesystem>
+#include <cstring>
 #include "ShaderProgram.h"
+#include "GLState.h"
+#include "FileCache.h"
+
+// Compiled programs are written here as glGetProgramBinary blobs, one file per
+// source + driver combination, and reloaded on the next launch to skip compiling
+constexpr char SHADER_CACHE_DIRECTORY[] = "shader_cache";
+
+// Everything compiled or linked this run, so programs sharing a stage (or
+// loading the exact same pair twice) reuse the existing GL objects
+static std::unordered_map<uint64_t, GLuint> s_compiled_shaders;
+static std::unordered_map<uint64_t, ShaderProgram> s_linked_programs;
+
+static uint64_t driver_hash()
+{
+    // A binary is only valid for the driver that produced it
+    static uint64_t hash = 0;
+    if (hash == 0)
+    {
+        const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        hash = file_cache::hash_bytes(std::string("driver"));
+        for (GLenum name : names)
+        {
+            const GLubyte* value = glGetString(name);
+            if (value != nullptr) hash = file_cache::hash_bytes(std::string((const char*) value), hash);
+        }
+    }
+    return hash;
+}
+
+// Sources are written in GLSL 1.10. Where uniform blocks exist they are built
+// as 1.40 instead, with the old keywords mapped onto their replacements.
+static const char* shader_prelude(GLenum type)
+{
+    if (!Camera::is_buffer_supported()) return "";
+    
+    if (type == GL_VERTEX_SHADER)
+    {
+        return "#version 140\n"
+               "#define CAMERA_BLOCK\n"
+               "#define attribute in\n"
+               "#define varying out\n";
+    }
+    return "#version 140\n"
+           "#define varying in\n"
+           "#define texture2D texture\n"
+           "out vec4 fragColor;\n"
+           "#define gl_FragColor fragColor\n";
+}
+
+static bool supports_program_binary()
+{
+    GLint format_count = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    return format_count > 0;
+}
+
+static std::string cache_filepath(uint64_t cache_key)
+{
+    return file_cache::filepath(SHADER_CACHE_DIRECTORY, cache_key, "bin");
+}
 
 void ShaderProgram::load(const char *vertex_shader_file, const char *fragment_shader_file) {
     
-    // create the vertex shader
-    m_vertex_shader = load_shader_from_file(vertex_shader_file, GL_VERTEX_SHADER);
-    // create the fragment shader
-    m_fragment_shader = load_shader_from_file(fragment_shader_file, GL_FRAGMENT_SHADER);
+    std::string vertex_source   = read_shader_source(vertex_shader_file);
+    std::string fragment_source = read_shader_source(fragment_shader_file);
     
-    // Create the final shader program from our vertex and fragment shaders
-    m_program_id = glCreateProgram();
-    glAttachShader(m_program_id, m_vertex_shader);
-    glAttachShader(m_program_id, m_fragment_shader);
-    glLinkProgram(m_program_id);
+    // Same pair of sources already linked this run? Share it, locations and all
+    uint64_t program_key = file_cache::hash_bytes(fragment_source, file_cache::hash_bytes(vertex_source));
+    auto linked = s_linked_programs.find(program_key);
+    if (linked != s_linked_programs.end())
+    {
+        AssetPack* asset_pack = m_asset_pack;
+        *this = linked->second;
+        m_asset_pack = asset_pack;
+        return;
+    }
     
-    GLint link_success;
-    glGetProgramiv(m_program_id, GL_LINK_STATUS, &link_success);
+    m_program_id      = glCreateProgram();
+    m_vertex_shader   = 0;
+    m_fragment_shader = 0;
     
-    if(link_success == GL_FALSE)
+    uint64_t cache_key = program_key ^ driver_hash();
+    if (!load_program_binary(cache_key))
     {
-        printf("Error linking shader program!\n");
+        // create the vertex shader
+        m_vertex_shader = load_shader_from_string(vertex_source, GL_VERTEX_SHADER);
+        // create the fragment shader
+        m_fragment_shader = load_shader_from_string(fragment_source, GL_FRAGMENT_SHADER);
+        
+        // Create the final shader program from our vertex and fragment shaders
+        bool retrievable = supports_program_binary();
+        if (retrievable) glProgramParameteri(m_program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        
+        glAttachShader(m_program_id, m_vertex_shader);
+        glAttachShader(m_program_id, m_fragment_shader);
+        glLinkProgram(m_program_id);
+        
+        GLint link_success;
+        glGetProgramiv(m_program_id, GL_LINK_STATUS, &link_success);
+        
+        if(link_success == GL_FALSE)
+        {
+            printf("Error linking shader program!\n");
+        }
+        else if (retrievable)
+        {
+            save_program_binary(cache_key);
+        }
     }
     
-    m_model_matrix_uniform      = glGetUniformLocation(m_program_id, "modelMatrix");
-    m_projection_matrix_uniform = glGetUniformLocation(m_program_id, "projectionMatrix");
-    m_view_matrix_uniform       = glGetUniformLocation(m_program_id, "viewMatrix");
-    m_colour_uniform            = glGetUniformLocation(m_program_id, "color");
+    m_model_matrix_uniform           = glGetUniformLocation(m_program_id, "modelMatrix");
+    m_view_projection_matrix_uniform = glGetUniformLocation(m_program_id, "viewProjectionMatrix");
+    m_colour_uniform                 = glGetUniformLocation(m_program_id, "color");
+    
+    // Point the program's camera block at the buffer the Camera keeps bound
+    if (Camera::is_buffer_supported())
+    {
+        GLuint camera_block = glGetUniformBlockIndex(m_program_id, "Camera");
+        if (camera_block != GL_INVALID_INDEX) glUniformBlockBinding(m_program_id, camera_block, Camera::BINDING_POINT);
+    }
     
     m_position_attribute  = glGetAttribLocation(m_program_id, "position");
     m_tex_coord_attribute = glGetAttribLocation(m_program_id, "texCoord");
     
     set_colour(1.0f, 1.0f, 1.0f, 1.0f);
     
+    s_linked_programs[program_key] = *this;
+}
+
+bool ShaderProgram::load_program_binary(uint64_t cache_key)
+{
+    if (!supports_program_binary()) return false;
+    
+    std::ifstream infile(cache_filepath(cache_key), std::ios::binary);
+    if (infile.fail()) return false;
+    
+    GLenum format;
+    GLint  length;
+    infile.read((char*) &format, sizeof(format));
+    infile.read((char*) &length, sizeof(length));
+    if (!infile || length <= 0) return false;
+    
+    std::string binary(length, '\0');
+    infile.read(&binary[0], length);
+    if (!infile) return false;
+    
+    glProgramBinary(m_program_id, format, binary.data(), length);
+    
+    // Drivers reject binaries after an update; that just means compiling again
+    GLint link_success;
+    glGetProgramiv(m_program_id, GL_LINK_STATUS, &link_success);
+    return link_success == GL_TRUE;
+}
+
+void ShaderProgram::save_program_binary(uint64_t cache_key)
+{
+    GLint length = 0;
+    glGetProgramiv(m_program_id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    
+    std::string binary(length, '\0');
+    GLenum format;
+    glGetProgramBinary(m_program_id, length, &length, &format, &binary[0]);
+    
+    std::error_code error;
+    std::filesystem::create_directories(SHADER_CACHE_DIRECTORY, error);
+    
+    std::ofstream outfile(cache_filepath(cache_key), std::ios::binary);
+    if (outfile.fail())
+    {
+        std::cout << "Unable to write shader cache to " << SHADER_CACHE_DIRECTORY << std::endl;
+        return;
+    }
+    
+    outfile.write((const char*) &format, sizeof(format));
+    outfile.write((const char*) &length, sizeof(length));
+    outfile.write(binary.data(), length);
 }
 
 void ShaderProgram::cleanup()
@@ -42,34 +189,54 @@ void ShaderProgram::cleanup()
     glDeleteShader(m_fragment_shader);
 }
 
-GLuint ShaderProgram::load_shader_from_file(const std::string &shaderFile, GLenum type)
+std::string ShaderProgram::read_shader_source(const std::string &shaderFile)
 {
+    // Shaders bundled in the asset pack are read straight from the mapping
+    AssetView packed;
+    if (m_asset_pack != nullptr && m_asset_pack->find(shaderFile, &packed))
+    {
+        return std::string((const char*) packed.data, packed.size);
+    }
+    
     //Open a file stream with the file name
-    std::ifstream infile(shaderFile);
+    std::ifstream infile(shaderFile, std::ios::binary | std::ios::ate);
     
     if(infile.fail()) {
         std::cout << "Error opening shader file:" << shaderFile << std::endl;
+        return std::string();
     }
     
-    //Create a string buffer and stream the file to it
-    std::stringstream buffer;
-    buffer << infile.rdbuf();
+    // Read the whole file into the string in one go
+    std::string contents((size_t) infile.tellg(), '\0');
+    infile.seekg(0);
+    infile.read(&contents[0], contents.size());
     
+    return contents;
+}
+
+GLuint ShaderProgram::load_shader_from_file(const std::string &shaderFile, GLenum type)
+{
     // Load the shader from the contents of the file
-    return load_shader_from_string(buffer.str(), type);
+    return load_shader_from_string(read_shader_source(shaderFile), type);
 }
 
 GLuint ShaderProgram::load_shader_from_string(const std::string &shaderContents, GLenum type)
 {
+    // Stages shared between programs are only compiled once
+    uint64_t shader_key = file_cache::hash_bytes(shaderContents) ^ type;
+    auto compiled = s_compiled_shaders.find(shader_key);
+    if (compiled != s_compiled_shaders.end()) return compiled->second;
+    
     // Create a shader of specified type
     GLuint shaderID = glCreateShader(type);
     
-    // Get the pointer to the C string from the STL string
-    const char *shader_string  = shaderContents.c_str();
-    GLint shader_string_length = (GLint) shaderContents.size();
+    // Get the pointer to the C string from the STL string, behind the version prelude
+    const char *prelude = shader_prelude(type);
+    const char *shader_strings[] = { prelude, shaderContents.c_str() };
+    GLint shader_string_lengths[] = { (GLint) strlen(prelude), (GLint) shaderContents.size() };
     
     // Set the shader source to the string and compile shader
-    glShaderSource(shaderID, 1, &shader_string, &shader_string_length);
+    glShaderSource(shaderID, 2, shader_strings, shader_string_lengths);
     glCompileShader(shaderID);
     
     // Check if the shader compiled properly
@@ -83,31 +250,39 @@ GLuint ShaderProgram::load_shader_from_string(const std::string &shaderContents,
         glGetShaderInfoLog(shaderID, sizeof(messages), 0, &messages[0]);
         std::cout << messages << std::endl;
     }
+    else
+    {
+        s_compiled_shaders[shader_key] = shaderID;
+    }
     
     // return the shader id
     return shaderID;
 }
 
-void ShaderProgram::set_colour(float red, float green, float blue, float alpha)
+GLint ShaderProgram::get_uniform_location(const std::string &name)
 {
-    glUseProgram(m_program_id);
-    glUniform4f(m_colour_uniform, red, green, blue, alpha);
+    auto found = m_uniform_locations.find(name);
+    if (found != m_uniform_locations.end()) return found->second;
+    
+    GLint location = glGetUniformLocation(m_program_id, name.c_str());
+    m_uniform_locations[name] = location;
+    return location;
 }
 
-void ShaderProgram::set_view_matrix(const glm::mat4 &matrix)
+void ShaderProgram::set_colour(float red, float green, float blue, float alpha)
 {
-    glUseProgram(m_program_id);
-    glUniformMatrix4fv(m_view_matrix_uniform, 1, GL_FALSE, &matrix[0][0]);
+    gl_state::uniform_vec4(m_program_id, m_colour_uniform, glm::vec4(red, green, blue, alpha));
 }
 
 void ShaderProgram::set_model_matrix(const glm::mat4 &matrix)
 {
-    glUseProgram(m_program_id);
-    glUniformMatrix4fv(m_model_matrix_uniform, 1, GL_FALSE, &matrix[0][0]);
+    gl_state::uniform_matrix4(m_program_id, m_model_matrix_uniform, matrix);
 }
 
-void ShaderProgram::set_projection_matrix(const glm::mat4 &matrix)
+void ShaderProgram::set_camera(const Camera &camera)
 {
-    glUseProgram(m_program_id);
-    glUniformMatrix4fv(m_projection_matrix_uniform, 1, GL_FALSE, &matrix[0][0]);
+    // With a camera buffer every program already sees the shared block
+    if (Camera::is_buffer_supported()) return;
+    
+    gl_state::uniform_matrix4(m_program_id, m_view_projection_matrix_uniform, camera.get_view_projection_matrix());
 }
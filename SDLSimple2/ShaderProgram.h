@@ -9,21 +9,28 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <cstdint>
+#include <unordered_map>
 #include "glm/mat4x4.hpp"
+#include "AssetPack.h"
+#include "Camera.h"
 
 class ShaderProgram
 {
 private:
     void cleanup();
     
+    std::string read_shader_source(const std::string &shader_file);
     GLuint load_shader_from_string(const std::string &shader_contents, GLenum shader_type);
     GLuint load_shader_from_file(const std::string &shader_file, GLenum shader_type);
 
+    bool load_program_binary(uint64_t cache_key);
+    void save_program_binary(uint64_t cache_key);
+
     GLuint m_program_id;
 
-    GLuint m_projection_matrix_uniform;
     GLuint m_model_matrix_uniform;
-    GLuint m_view_matrix_uniform;
+    GLuint m_view_projection_matrix_uniform; // Only used when there is no camera buffer
     GLuint m_colour_uniform;
 
     GLuint m_position_attribute;
@@ -31,19 +38,26 @@ private:
 
     GLuint m_vertex_shader;
     GLuint m_fragment_shader;
+
+    AssetPack* m_asset_pack = nullptr;
+
+    // Lookups for uniforms beyond the fixed ones above, filled on first use
+    std::unordered_map<std::string, GLint> m_uniform_locations;
     
 public:
 
     void load(const char *vertex_shader_file, const char *fragment_shader_file);
 
     void set_model_matrix(const glm::mat4 &matrix);
-    void set_projection_matrix(const glm::mat4 &matrix);
-    void set_view_matrix(const glm::mat4 &matrix);
+    void set_camera(const Camera &camera);
     void set_colour(float red, float green, float blue, float alpha);
+
+    GLint get_uniform_location(const std::string &name);
     
     GLuint const get_program_id()               const { return m_program_id;          };
     GLuint const get_position_attribute()       const { return m_position_attribute;  };
     GLuint const get_tex_coordinate_attribute() const { return m_tex_coord_attribute; };
     
     void set_program_id(GLuint program_id)                         { m_program_id = program_id;                   };
+    void set_asset_pack(AssetPack* asset_pack)                     { m_asset_pack = asset_pack;                   };
 };
@@ -0,0 +1,70 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <iostream>
+#include <sstream>
+#include "TextureAtlas.h"
+#include "TextureLoader.h"
+
+TextureAtlas::TextureAtlas(TextureLoader* loader) : m_loader(loader) { }
+
+bool TextureAtlas::load(const char* manifest_filepath)
+{
+    std::stringstream infile;
+    if (!read_text_asset(m_loader->get_asset_pack(), manifest_filepath, &infile))
+    {
+        std::cout << "No texture atlas at " << manifest_filepath << ", using loose textures" << std::endl;
+        return false;
+    }
+
+    // Page sizes are needed to turn pixel rects into UVs
+    std::vector<glm::vec2> page_sizes;
+
+    std::string line;
+    while (std::getline(infile, line))
+    {
+        if (line.empty() || line[0] == '#') continue;
+
+        std::istringstream fields(line);
+        std::string kind, path;
+        fields >> kind >> path;
+
+        if (kind == "page")
+        {
+            float width, height;
+            fields >> width >> height;
+
+            m_page_texture_ids.push_back(m_loader->request(path.c_str()));
+            page_sizes.push_back(glm::vec2(width, height));
+        }
+        else if (kind == "region")
+        {
+            int page;
+            float x, y, width, height;
+            fields >> page >> x >> y >> width >> height;
+
+            if (page < 0 || page >= (int) m_page_texture_ids.size())
+            {
+                std::cout << "Atlas region " << path << " refers to missing page " << page << std::endl;
+                continue;
+            }
+
+            AtlasRegion region(m_page_texture_ids[page]);
+            region.uv_offset = glm::vec2(x, y) / page_sizes[page];
+            region.uv_scale  = glm::vec2(width, height) / page_sizes[page];
+            m_regions[path]  = region;
+        }
+    }
+
+    return true;
+}
+
+AtlasRegion TextureAtlas::get_region(const std::string &filepath)
+{
+    auto found = m_regions.find(filepath);
+    if (found != m_regions.end()) return found->second;
+
+    // Not packed; load it on its own and remember it so it is only loaded once
+    AtlasRegion region(m_loader->request(filepath.c_str()));
+    m_regions[filepath] = region;
+    return region;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "glm/glm.hpp"
+
+class TextureLoader;
+
+// A sub-rect of a texture in UV space. A region covering a whole texture has
+// offset (0, 0) and scale (1, 1), so loose textures and atlas pages look the same.
+struct AtlasRegion
+{
+    GLuint    texture_id = 0;
+    glm::vec2 uv_offset  = glm::vec2(0.0f);
+    glm::vec2 uv_scale   = glm::vec2(1.0f);
+
+    AtlasRegion() {}
+    AtlasRegion(GLuint texture_id) : texture_id(texture_id) {}
+
+    // Maps a UV inside the sprite to a UV on the page
+    float const u(float sprite_u) const { return uv_offset.x + sprite_u * uv_scale.x; }
+    float const v(float sprite_v) const { return uv_offset.y + sprite_v * uv_scale.y; }
+};
+
+// Runtime side of tools/atlas_packer.cpp: loads the generated manifest,
+// requests each page through the TextureLoader and hands out regions by the
+// original asset path. Paths missing from the manifest fall back to loading
+// the loose image, so the game still runs before the packer has been re-run.
+class TextureAtlas
+{
+private:
+    TextureLoader* m_loader;
+
+    std::vector<GLuint> m_page_texture_ids;
+    std::unordered_map<std::string, AtlasRegion> m_regions;
+
+public:
+    // ————— METHODS ————— //
+    TextureAtlas(TextureLoader* loader);
+
+    bool load(const char* manifest_filepath);
+    AtlasRegion get_region(const std::string &filepath);
+
+    // ————— GETTERS ————— //
+    int const get_page_count() const { return (int) m_page_texture_ids.size(); }
+};
@@ -0,0 +1,181 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <iostream>
+#include <cassert>
+#include "stb_image.h"
+#include "TextureLoader.h"
+#include "GLState.h"
+
+constexpr int NUMBER_OF_TEXTURES = 1;
+constexpr GLint LEVEL_OF_DETAIL  = 0;
+constexpr GLint TEXTURE_BORDER   = 0;
+
+// 2x2 grey checker shown while the real image is still decoding
+constexpr int PLACEHOLDER_SIZE = 2;
+constexpr unsigned char PLACEHOLDER_PIXELS[] =
+{
+    160, 160, 160, 255,   96,  96,  96, 255,
+     96,  96,  96, 255,  160, 160, 160, 255
+};
+
+TextureLoader::TextureLoader(int worker_count, int uploads_per_frame)
+    : m_uploads_per_frame(uploads_per_frame)
+{
+    if (worker_count < 1) worker_count = 1;
+
+    for (int i = 0; i < worker_count; i++)
+    {
+        m_workers.emplace_back(&TextureLoader::worker_loop, this);
+    }
+}
+
+TextureLoader::~TextureLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_jobs_mutex);
+        m_stopping = true;
+    }
+    m_jobs_ready.notify_all();
+
+    for (std::thread &worker : m_workers) worker.join();
+
+    // Anything decoded but never uploaded still belongs to us
+    for (DecodedImage &image : m_decoded)
+    {
+        if (image.pixels != NULL && !image.mapped) stbi_image_free(image.pixels);
+    }
+}
+
+void TextureLoader::worker_loop()
+{
+    while (true)
+    {
+        DecodeJob job;
+        {
+            std::unique_lock<std::mutex> lock(m_jobs_mutex);
+            m_jobs_ready.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+
+            if (m_stopping) return;
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        DecodedImage image = { job.texture_id, job.filepath, 0, 0, NULL, false };
+        int number_of_components;
+        if (job.packed.data != nullptr)
+        {
+            image.pixels = stbi_load_from_memory(job.packed.data, (int) job.packed.size, &image.width, &image.height,
+                                                 &number_of_components, STBI_rgb_alpha);
+        }
+        else
+        {
+            image.pixels = stbi_load(job.filepath.c_str(), &image.width, &image.height,
+                                     &number_of_components, STBI_rgb_alpha);
+        }
+
+        std::lock_guard<std::mutex> lock(m_decoded_mutex);
+        m_decoded.push_back(image);
+    }
+}
+
+GLuint TextureLoader::request(const char* filepath)
+{
+    // The texture name exists from the start so callers can hold on to it
+    GLuint textureID;
+    glGenTextures(NUMBER_OF_TEXTURES, &textureID);
+    gl_state::bind_texture(textureID);
+    glTexImage2D(GL_TEXTURE_2D, LEVEL_OF_DETAIL, GL_RGBA, PLACEHOLDER_SIZE, PLACEHOLDER_SIZE,
+                 TEXTURE_BORDER, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER_PIXELS);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    m_outstanding++;
+
+    AssetView packed;
+    if (m_asset_pack != nullptr && m_asset_pack->find(filepath, &packed) && packed.kind == asset_pack::TEXTURE_RGBA)
+    {
+        // Already decoded at pack time, so it skips the workers and just waits for its upload slot
+        DecodedImage image = { textureID, filepath, packed.width, packed.height, (unsigned char*) packed.data, true };
+
+        std::lock_guard<std::mutex> lock(m_decoded_mutex);
+        m_decoded.push_back(image);
+        return textureID;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_jobs_mutex);
+        m_jobs.push_back({ textureID, filepath, packed });
+    }
+    m_jobs_ready.notify_one();
+
+    return textureID;
+}
+
+void TextureLoader::upload(const DecodedImage &image)
+{
+    if (image.pixels == NULL)
+    {
+        std::cout << "Unable to load image " << image.filepath << ". Make sure the path is correct." << std::endl;
+        assert(false);
+        return;
+    }
+
+    gl_state::bind_texture(image.texture_id);
+    glTexImage2D(GL_TEXTURE_2D, LEVEL_OF_DETAIL, GL_RGBA, image.width, image.height,
+                 TEXTURE_BORDER, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
+    gl_state::count_upload((size_t) image.width * image.height * 4);
+
+    if (!image.mapped) stbi_image_free(image.pixels);
+}
+
+void TextureLoader::upload_pending()
+{
+    // Only GL calls happen here, so this must run on the thread owning the context.
+    // The budget keeps a burst of finished decodes from stalling a single frame.
+    for (int uploaded = 0; uploaded < m_uploads_per_frame && m_outstanding > 0; uploaded++)
+    {
+        DecodedImage image;
+        {
+            std::lock_guard<std::mutex> lock(m_decoded_mutex);
+            if (m_decoded.empty()) return;
+
+            image = m_decoded.front();
+            m_decoded.pop_front();
+        }
+
+        upload(image);
+        m_outstanding--;
+    }
+}
+
+void TextureLoader::upload_all()
+{
+    while (m_outstanding > 0)
+    {
+        DecodedImage image;
+        bool has_image = false;
+        {
+            std::lock_guard<std::mutex> lock(m_decoded_mutex);
+            if (!m_decoded.empty())
+            {
+                image = m_decoded.front();
+                m_decoded.pop_front();
+                has_image = true;
+            }
+        }
+
+        if (!has_image)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        upload(image);
+        m_outstanding--;
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "AssetPack.h"
+
+// Decodes PNGs on worker threads and uploads them on the main thread.
+// request() hands back a texture name straight away that shows a placeholder
+// until upload_pending() swaps the decoded pixels into it, so entities can be
+// built with their final texture id before anything has finished loading.
+// With an AssetPack attached, pre-decoded textures skip the workers entirely.
+class TextureLoader
+{
+private:
+    struct DecodeJob
+    {
+        GLuint      texture_id;
+        std::string filepath;
+        AssetView   packed; // Still-encoded bytes from the pack, if it has them
+    };
+
+    struct DecodedImage
+    {
+        GLuint         texture_id;
+        std::string    filepath;
+        int            width;
+        int            height;
+        unsigned char* pixels;  // Owned by stb_image until uploaded...
+        bool           mapped;  // ...unless it points straight into the asset pack
+    };
+
+    // ————— WORKERS ————— //
+    std::vector<std::thread> m_workers;
+    std::deque<DecodeJob>    m_jobs;
+    std::mutex               m_jobs_mutex;
+    std::condition_variable  m_jobs_ready;
+    bool                     m_stopping = false;
+
+    // ————— UPLOADS ————— //
+    std::deque<DecodedImage> m_decoded;
+    std::mutex               m_decoded_mutex;
+
+    AssetPack* m_asset_pack = nullptr;
+
+    int m_uploads_per_frame;
+    int m_outstanding = 0; // Requested but not yet uploaded; main thread only
+
+    void worker_loop();
+    void upload(const DecodedImage &image);
+
+public:
+    // ————— METHODS ————— //
+    TextureLoader(int worker_count, int uploads_per_frame);
+    ~TextureLoader();
+
+    GLuint request(const char* filepath);
+    void   upload_pending();
+    void   upload_all();
+
+    // ————— SETTERS ————— //
+    void set_asset_pack(AssetPack* asset_pack) { m_asset_pack = asset_pack; }
+
+    // ————— GETTERS ————— //
+    bool       const is_idle()        const { return m_outstanding == 0; }
+    AssetPack* const get_asset_pack() const { return m_asset_pack; }
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Lock-free hand-off of whole values from one producer thread to one consumer
+// thread. The producer fills write_slot() and publishes it; the consumer
+// fetch()es the newest published value into read_slot(). Neither side ever
+// waits, and a value the consumer never got round to is simply overwritten.
+// Slots are reused, so anything they own (e.g. vector capacity) is kept.
+template <typename T>
+class TripleBuffer
+{
+private:
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t FRESH_BIT  = 0x4; // Set when the shared slot hasn't been read yet
+
+    T m_slots[3];
+
+    // Each slot is owned by exactly one of: the producer, the consumer, or
+    // neither (the shared one). Publishing and fetching swap ownership.
+    uint8_t              m_write_index = 0;
+    uint8_t              m_read_index  = 1;
+    std::atomic<uint8_t> m_shared_index { 2 };
+
+public:
+    // ————— PRODUCER ————— //
+    T &write_slot() { return m_slots[m_write_index]; }
+
+    void publish()
+    {
+        m_write_index = m_shared_index.exchange(m_write_index | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // ————— CONSUMER ————— //
+    // Returns false (and keeps the current read slot) when nothing new was published
+    bool fetch()
+    {
+        if (!(m_shared_index.load(std::memory_order_relaxed) & FRESH_BIT)) return false;
+
+        m_read_index = m_shared_index.exchange(m_read_index, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    T const &read_slot() const { return m_slots[m_read_index]; }
+};
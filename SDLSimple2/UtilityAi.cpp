@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include "UtilityAi.h"
+#include "AssetPack.h"
+#include "NavGraph.h"
+#include "Profiler.h"
+#include "FrameStats.h"
+
+namespace
+{
+    // Same order as the enums
+    const char* const INPUT_NAMES[]  = { "player_distance", "can_see_player", "heard_noise", "ally_died", "on_ground", "blocked", "path_cost" };
+    const char* const CURVE_NAMES[]  = { "linear", "polynomial", "sigmoid" };
+    const char* const ACTION_NAMES[] = { "stop", "walk_left", "walk_right", "chase_player", "flee_player", "investigate", "jump" };
+
+    template <size_t N>
+    int find_name(const char* const (&names)[N], const std::string &name)
+    {
+        for (int i = 0; i < (int) N; i++)
+        {
+            if (name == names[i]) return i;
+        }
+        return -1;
+    }
+
+    float towards(const Entity* entity, glm::vec3 target) { return entity->get_position().x > target.x ? -1.0f : 1.0f; }
+
+    // The NavGraph's route cost to the player in seconds, scaled by the
+    // agent's speed so it reads like a distance and normalised the same way
+    // as INPUT_PLAYER_DISTANCE. Without a graph it is the straight distance.
+    float path_cost_input(const Entity* entity, NavGraph* nav_graph)
+    {
+        const Percept &percept = entity->get_percept();
+        if (!percept.senses[STIMULUS_PLAYER]) return 1.0f;
+        if (!nav_graph) return std::min(percept.distances[STIMULUS_PLAYER] / PERCEPTION_RANGE, 1.0f);
+
+        float cost = nav_graph->path_cost(*entity, percept.positions[STIMULUS_PLAYER]);
+        if (cost == FLT_MAX) return 1.0f;
+        return std::min(cost * entity->get_speed() / PERCEPTION_RANGE, 1.0f);
+    }
+
+    void act(Entity* entity, UtilityAction action, NavGraph* nav_graph)
+    {
+        const Percept &percept = entity->get_percept();
+        glm::vec3 player = percept.positions[STIMULUS_PLAYER];
+        glm::vec3 disturbance;
+
+        switch (action)
+        {
+            case ACTION_STOP:         entity->set_movement(glm::vec3(0.0f));                                break;
+            case ACTION_WALK_LEFT:    entity->set_movement(glm::vec3(-1.0f, 0.0f, 0.0f));                   break;
+            case ACTION_WALK_RIGHT:   entity->set_movement(glm::vec3(1.0f, 0.0f, 0.0f));                    break;
+            case ACTION_CHASE_PLAYER: steer_towards(nav_graph, entity, player);                             break;
+            case ACTION_FLEE_PLAYER:  entity->set_movement(glm::vec3(-towards(entity, player), 0.0f, 0.0f)); break;
+            case ACTION_JUMP:         entity->jump();                                                       break;
+
+            case ACTION_INVESTIGATE:
+                if (percept.nearest_disturbance(&disturbance)) steer_towards(nav_graph, entity, disturbance);
+                else                                           entity->set_movement(glm::vec3(0.0f));
+                break;
+        }
+    }
+}
+
+bool UtilityAi::load(const char* filepath)
+{
+    std::stringstream infile;
+    if (!read_text_asset(m_asset_pack, filepath, &infile))
+    {
+        std::cout << "No utility AI profiles at " << filepath << std::endl;
+        return false;
+    }
+
+    if (parse(infile, filepath)) return true;
+
+    m_considerations.clear();
+    m_options.clear();
+    m_profiles.clear();
+    m_profile_indices.clear();
+    return false;
+}
+
+// Keywords nest by position, not indentation:
+//
+//   profile guard
+//       option chase_player 1
+//           consider can_see_player linear
+//           consider player_distance sigmoid slope=-20 x_shift=0.3
+//
+// Curve parameters are optional key=value pairs (slope, exponent, x_shift,
+// y_shift) defaulting to 1, 1, 0 and 0.
+bool UtilityAi::parse(std::istream &infile, const char* filepath)
+{
+    TextAssetReader reader(infile, filepath);
+
+    while (reader.next_line())
+    {
+        std::istringstream fields(reader.get_line());
+        std::string keyword;
+        fields >> keyword;
+
+        if (keyword == "profile")
+        {
+            if (!m_profiles.empty() && m_profiles.back().option_count == 0) return reader.fail("previous profile has no options");
+
+            std::string name;
+            if (!(fields >> name)) return reader.fail("profile needs a name");
+            if (m_profile_indices.count(name)) return reader.fail("profile " + name + " is defined twice");
+
+            UtilityProfile profile;
+            profile.first_option = (int) m_options.size();
+
+            m_profile_indices[name] = (int) m_profiles.size();
+            m_profiles.push_back(profile);
+        }
+        else if (keyword == "option")
+        {
+            if (m_profiles.empty()) return reader.fail("option outside of a profile");
+            if (m_profiles.back().option_count == UTILITY_MAX_OPTIONS) return reader.fail("profile has more than " + std::to_string(UTILITY_MAX_OPTIONS) + " options");
+
+            std::string action;
+            UtilityOption option;
+            if (!(fields >> action >> option.weight)) return reader.fail("option needs an action and a weight");
+
+            int found = find_name(ACTION_NAMES, action);
+            if (found < 0) return reader.fail("unknown action " + action);
+
+            option.action              = (UtilityAction) found;
+            option.first_consideration = (int) m_considerations.size();
+
+            m_options.push_back(option);
+            m_profiles.back().option_count++;
+        }
+        else if (keyword == "consider")
+        {
+            if (m_options.empty() || m_profiles.back().option_count == 0) return reader.fail("consider outside of an option");
+
+            std::string input, curve;
+            if (!(fields >> input >> curve)) return reader.fail("consider needs an input and a curve");
+
+            int found_input = find_name(INPUT_NAMES, input);
+            int found_curve = find_name(CURVE_NAMES, curve);
+            if (found_input < 0) return reader.fail("unknown input " + input);
+            if (found_curve < 0) return reader.fail("unknown curve " + curve);
+
+            UtilityConsideration consideration;
+            consideration.input = (UtilityInput) found_input;
+            consideration.curve = (UtilityCurve) found_curve;
+
+            std::string parameter;
+            while (fields >> parameter)
+            {
+                std::string::size_type equals = parameter.find('=');
+                if (equals == std::string::npos) return reader.fail("expected key=value, got " + parameter);
+
+                std::string key = parameter.substr(0, equals);
+                float value = strtof(parameter.c_str() + equals + 1, nullptr);
+
+                if      (key == "slope")    consideration.slope    = value;
+                else if (key == "exponent") consideration.exponent = (int) value;
+                else if (key == "x_shift")  consideration.x_shift  = value;
+                else if (key == "y_shift")  consideration.y_shift  = value;
+                else return reader.fail("unknown curve parameter " + key);
+            }
+            if (consideration.exponent < 0) return reader.fail("exponent must be a whole number from 0 up");
+
+            m_considerations.push_back(consideration);
+            m_options.back().consideration_count++;
+        }
+        else
+        {
+            return reader.fail("unknown keyword " + keyword);
+        }
+    }
+
+    if (!m_profiles.empty() && m_profiles.back().option_count == 0) return reader.fail("last profile has no options");
+    return true;
+}
+
+int UtilityAi::find_profile(const std::string &name) const
+{
+    auto found = m_profile_indices.find(name);
+    return found == m_profile_indices.end() ? -1 : found->second;
+}
+
+void UtilityAi::add_agent(int profile, Entity* entity)
+{
+    m_agent_options.push_back(0);
+
+    int agent = m_agents.add(profile, entity, [this](int from, int to) { m_agent_options[to] = m_agent_options[from]; });
+    m_agent_options[agent] = 0;
+
+    entity->set_has_external_ai(true);
+}
+
+bool UtilityAi::remove_agent(Entity* entity)
+{
+    if (!m_agents.remove(entity, [this](int from, int to) { m_agent_options[to] = m_agent_options[from]; })) return false;
+
+    m_agent_options.pop_back();
+    entity->set_has_external_ai(false);
+    return true;
+}
+
+void UtilityAi::clear_agents()
+{
+    for (Entity* entity : m_agents.get_entities()) entity->set_has_external_ai(false);
+
+    m_agents.clear();
+    m_agent_options.clear();
+}
+
+// Copies what the profile's awake agents perceive into the batch arrays, one
+// array per input
+void UtilityAi::gather_inputs(int profile)
+{
+    m_batch_agents.clear();
+    for (int agent = m_agents.get_group_start(profile); agent < m_agents.get_group_end(profile); agent++)
+    {
+        const Entity* entity = m_agents.get_entity(agent);
+        if (entity->get_is_active() && entity->get_update_due() && !entity->get_is_sleeping()) m_batch_agents.push_back(agent);
+    }
+
+    int count = (int) m_batch_agents.size();
+    for (std::vector<float> &input : m_batch_inputs) input.resize(count);
+    m_batch_previous.resize(count);
+    m_batch_scores.resize(count);
+    m_batch_curve.resize(count);
+    m_batch_best_scores.resize(count);
+    m_batch_best_options.resize(count);
+
+    for (int i = 0; i < count; i++)
+    {
+        const Entity*  entity  = m_agents.get_entity(m_batch_agents[i]);
+        const Percept &percept = entity->get_percept();
+
+        float distance = percept.senses[STIMULUS_PLAYER] ? percept.distances[STIMULUS_PLAYER] : PERCEPTION_RANGE;
+
+        m_batch_inputs[INPUT_PLAYER_DISTANCE][i] = std::min(distance / PERCEPTION_RANGE, 1.0f);
+        m_batch_inputs[INPUT_CAN_SEE_PLAYER][i]  = percept.can_see_player ? 1.0f : 0.0f;
+        m_batch_inputs[INPUT_HEARD_NOISE][i]     = percept.senses[STIMULUS_NOISE] ? 1.0f : 0.0f;
+        m_batch_inputs[INPUT_ALLY_DIED][i]       = percept.senses[STIMULUS_ALLY_DEATH] ? 1.0f : 0.0f;
+        m_batch_inputs[INPUT_ON_GROUND][i]       = entity->get_collided_bottom() ? 1.0f : 0.0f;
+        m_batch_inputs[INPUT_BLOCKED][i]         = entity->get_collided_left() || entity->get_collided_right() ? 1.0f : 0.0f;
+        m_batch_inputs[INPUT_PATH_COST][i]       = path_cost_input(entity, m_nav_graph);
+        m_batch_previous[i] = (float) m_agent_options[m_batch_agents[i]];
+    }
+}
+
+// Multiplies every score in the batch by the consideration's curve. The curve
+// parameters are copied out first so the loops don't reload them.
+void UtilityAi::score_consideration(const UtilityConsideration &consideration, int count)
+{
+    const float* inputs = m_batch_inputs[consideration.input].data();
+    float* curve  = m_batch_curve.data();
+    float* scores = m_batch_scores.data();
+
+    const float slope   = consideration.slope;
+    const float x_shift = consideration.x_shift;
+    const float y_shift = consideration.y_shift;
+
+    switch (consideration.curve)
+    {
+        case CURVE_LINEAR:
+            for (int i = 0; i < count; i++) curve[i] = slope * (inputs[i] - x_shift) + y_shift;
+            break;
+
+        case CURVE_POLYNOMIAL:
+            for (int i = 0; i < count; i++) curve[i] = 1.0f;
+            for (int power = 0; power < consideration.exponent; power++)
+            {
+                for (int i = 0; i < count; i++) curve[i] *= inputs[i] - x_shift;
+            }
+            for (int i = 0; i < count; i++) curve[i] = slope * curve[i] + y_shift;
+            break;
+
+        case CURVE_SIGMOID:
+            // z / (1 + |z|) rather than a logistic: the same shape, without exp()
+            for (int i = 0; i < count; i++)
+            {
+                float z = slope * (inputs[i] - x_shift);
+                curve[i] = 0.5f + 0.5f * z / (1.0f + fabsf(z)) + y_shift;
+            }
+            break;
+    }
+
+    for (int i = 0; i < count; i++) scores[i] *= std::min(std::max(curve[i], 0.0f), 1.0f);
+}
+
+void UtilityAi::tick()
+{
+    PROFILE_ZONE("utility ai");
+
+    int decisions = 0;
+    for (int profile_index = 0; profile_index < get_profile_count(); profile_index++)
+    {
+        gather_inputs(profile_index);
+
+        int count = (int) m_batch_agents.size();
+        if (count == 0) continue;
+
+        const UtilityProfile &profile = m_profiles[profile_index];
+        float* scores       = m_batch_scores.data();
+        float* best_scores  = m_batch_best_scores.data();
+        float* best_options = m_batch_best_options.data();
+        const float* previous = m_batch_previous.data();
+
+        std::fill(best_scores,  best_scores  + count, -1.0f);
+        std::fill(best_options, best_options + count, 0.0f);
+
+        for (int option_index = 0; option_index < profile.option_count; option_index++)
+        {
+            const UtilityOption &option = m_options[profile.first_option + option_index];
+
+            std::fill(scores, scores + count, option.weight);
+            for (int i = 0; i < option.consideration_count; i++)
+            {
+                score_consideration(m_considerations[option.first_consideration + i], count);
+            }
+
+            // Keep the best so far with selects rather than branches
+            const float index = (float) option_index;
+            for (int i = 0; i < count; i++)
+            {
+                float score  = scores[i] * (previous[i] == index ? UTILITY_MOMENTUM : 1.0f);
+                bool  better = score > best_scores[i];
+                best_scores[i]  = better ? score : best_scores[i];
+                best_options[i] = better ? index : best_options[i];
+            }
+        }
+
+        // Acting touches each entity anyway, so this part goes agent by agent
+        for (int i = 0; i < count; i++)
+        {
+            int agent  = m_batch_agents[i];
+            int option = (int) best_options[i];
+
+            m_agent_options[agent] = (uint8_t) option;
+            act(m_agents.get_entity(agent), m_options[profile.first_option + option].action, m_nav_graph);
+        }
+        decisions += count;
+    }
+    frame_stats::current().ai_decisions += decisions;
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "Entity.h"
+#include "AgentGroups.h"
+
+class AssetPack;
+class NavGraph;
+
+// What an agent knows about its situation, each normalised to [0, 1]
+enum UtilityInput
+{
+    INPUT_PLAYER_DISTANCE, // 0 at the player, 1 at PERCEPTION_RANGE or when not sensed
+    INPUT_CAN_SEE_PLAYER,  // 0 or 1
+    INPUT_HEARD_NOISE,     // 0 or 1
+    INPUT_ALLY_DIED,       // 0 or 1, sensed an ally being killed
+    INPUT_ON_GROUND,       // 0 or 1
+    INPUT_BLOCKED,         // 0 or 1, ran into something left or right last step
+    INPUT_PATH_COST,       // Like INPUT_PLAYER_DISTANCE, but the way round along the NavGraph
+    INPUT_COUNT
+};
+
+// Response curves, all branch-free so a whole batch goes through one loop.
+// x is the input minus x_shift; the result is clamped to [0, 1].
+enum UtilityCurve
+{
+    CURVE_LINEAR,     // slope * x + y_shift
+    CURVE_POLYNOMIAL, // slope * x^exponent + y_shift, whole exponents only
+    CURVE_SIGMOID     // S-shaped through 0.5 at x = 0, steeper with slope, + y_shift
+};
+
+// Chasing and fleeing go by where the player was last sensed; investigating
+// heads for the nearest noise or ally death and otherwise stops. Chasing and
+// investigating follow the NavGraph if there is one.
+enum UtilityAction { ACTION_STOP, ACTION_WALK_LEFT, ACTION_WALK_RIGHT, ACTION_CHASE_PLAYER, ACTION_FLEE_PLAYER, ACTION_INVESTIGATE, ACTION_JUMP };
+
+struct UtilityConsideration
+{
+    UtilityInput input;
+    UtilityCurve curve;
+    float slope    = 1.0f;
+    int   exponent = 1;
+    float x_shift  = 0.0f;
+    float y_shift  = 0.0f;
+};
+
+// Scores weight times every one of its considerations
+struct UtilityOption
+{
+    UtilityAction action;
+    float weight;
+    int   first_consideration;
+    int   consideration_count = 0;
+};
+
+struct UtilityProfile
+{
+    int first_option;
+    int option_count = 0;
+};
+
+constexpr float UTILITY_MOMENTUM    = 1.1f; // Bonus for staying with last tick's option, so close calls don't flicker
+constexpr int   UTILITY_MAX_OPTIONS = 256;  // Per profile, so the option each agent chose last fits in a byte
+
+// Utility-based enemy AI, an alternative to BehaviourTrees. Profiles are read
+// from a text file (see assets/enemies.ai); every tick each agent scores all
+// of its profile's options and acts on the best one. Agents are grouped by
+// profile and scored a consideration at a time across the whole group, with
+// the inputs and scores in flat arrays, so the curve maths runs as straight
+// loops the compiler can vectorise instead of a branchy walk per agent.
+// Inputs come from each entity's percept, so Perception has to be updated too.
+class UtilityAi
+{
+private:
+    std::vector<UtilityConsideration> m_considerations;
+    std::vector<UtilityOption>        m_options;
+    std::vector<UtilityProfile>       m_profiles;
+    std::unordered_map<std::string, int> m_profile_indices;
+
+    // ————— AGENTS ————— //
+    // Grouped by profile, with the option each chose last tick (relative to the profile) by slot
+    AgentGroups          m_agents;
+    std::vector<uint8_t> m_agent_options;
+
+    // ————— BATCH SCRATCH ————— //
+    // Sized to the agents awake in the profile being scored; kept to avoid reallocating
+    std::vector<int>    m_batch_agents;
+    std::vector<float>  m_batch_inputs[INPUT_COUNT];
+    std::vector<float>  m_batch_previous;  // Index of last tick's option, as a float for the select
+    std::vector<float>  m_batch_scores;
+    std::vector<float>  m_batch_curve;
+    std::vector<float>  m_batch_best_scores;
+    std::vector<float>  m_batch_best_options;
+
+    AssetPack* m_asset_pack = nullptr;
+    NavGraph*  m_nav_graph  = nullptr; // Chasing and investigating follow it when set
+
+    bool parse(std::istream &infile, const char* filepath);
+    void gather_inputs(int profile);
+    void score_consideration(const UtilityConsideration &consideration, int count);
+
+public:
+    // ————— METHODS ————— //
+    bool load(const char* filepath);
+    int  find_profile(const std::string &name) const;
+
+    void add_agent(int profile, Entity* entity);
+    bool remove_agent(Entity* entity); // False if it wasn't one
+    void clear_agents();
+    void tick();
+
+    // ————— GETTERS ————— //
+    int const get_profile_count() const { return (int) m_profiles.size();       }
+    int const get_agent_count()   const { return m_agents.get_count();          }
+
+    // ————— SETTERS ————— //
+    void set_asset_pack(AssetPack* asset_pack) { m_asset_pack = asset_pack; }
+    void set_nav_graph(NavGraph* nav_graph)    { m_nav_graph  = nav_graph;  }
+};
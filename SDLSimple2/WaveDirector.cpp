@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include "WaveDirector.h"
+#include "GameState.h"
+#include "AssetPack.h"
+#include "Profiler.h"
+
+namespace
+{
+    // Where free slots wait, the same place the death rule parks dead enemies
+    const glm::vec3 PARKED_POSITION = glm::vec3(-10.0f, -10.0f, 0.0f);
+
+    int find_ai_type(const std::string &name)
+    {
+        for (int i = 0; i < (int) (sizeof(AI_TYPE_NAMES) / sizeof(AI_TYPE_NAMES[0])); i++)
+        {
+            if (name == AI_TYPE_NAMES[i]) return i;
+        }
+        return -1;
+    }
+}
+
+bool WaveDirector::load(const char* filepath)
+{
+    std::stringstream infile;
+    if (!read_text_asset(m_asset_pack, filepath, &infile))
+    {
+        std::cout << "No spawn tables at " << filepath << std::endl;
+        return false;
+    }
+
+    m_spawns.clear();
+    m_waves.clear();
+    if (parse(infile, filepath)) return true;
+
+    m_spawns.clear();
+    m_waves.clear();
+    return false;
+}
+
+// Spawns belong to the wave above them:
+//
+//   wave 3
+//       spawn walker 2 1 count=3 every=1.5
+//       spawn guard 11 1 at=4
+//
+// A wave's delay counts from when the wave before it is cleared. Each spawn
+// line is count enemies (1 by default) of an AI type at a position in world
+// units, the first at seconds into the wave (0) and the rest every seconds
+// after it (0).
+bool WaveDirector::parse(std::istream &infile, const char* filepath)
+{
+    TextAssetReader reader(infile, filepath);
+
+    while (reader.next_line())
+    {
+        std::istringstream fields(reader.get_line());
+        std::string keyword;
+        fields >> keyword;
+
+        if (keyword == "wave")
+        {
+            if (!m_waves.empty() && m_waves.back().spawn_count == 0) return reader.fail("previous wave has no spawns");
+
+            Wave wave;
+            if (!(fields >> wave.delay) || wave.delay < 0.0f) return reader.fail("wave needs a delay of 0 or more seconds");
+            wave.first_spawn = (int) m_spawns.size();
+            wave.spawn_count = 0;
+
+            m_waves.push_back(wave);
+        }
+        else if (keyword == "spawn")
+        {
+            if (m_waves.empty()) return reader.fail("spawn outside of a wave");
+
+            std::string type;
+            float x, y;
+            if (!(fields >> type >> x >> y)) return reader.fail("spawn needs an AI type and a position");
+
+            int found = find_ai_type(type);
+            if (found < 0) return reader.fail("unknown AI type " + type);
+
+            int   count = 1;
+            float at    = 0.0f,
+                  every = 0.0f;
+
+            std::string parameter;
+            while (fields >> parameter)
+            {
+                std::string::size_type equals = parameter.find('=');
+                if (equals == std::string::npos) return reader.fail("expected key=value, got " + parameter);
+
+                std::string key = parameter.substr(0, equals);
+                float value = strtof(parameter.c_str() + equals + 1, nullptr);
+
+                if      (key == "count") count = (int) value;
+                else if (key == "at")    at    = value;
+                else if (key == "every") every = value;
+                else return reader.fail("unknown spawn parameter " + key);
+            }
+            if (count < 1)                   return reader.fail("count must be at least 1");
+            if (at < 0.0f || every < 0.0f)   return reader.fail("at and every can't be negative");
+
+            for (int i = 0; i < count; i++)
+            {
+                m_spawns.push_back({ at + i * every, (AIType) found, glm::vec3(x, y, 0.0f) });
+            }
+            m_waves.back().spawn_count += count;
+        }
+        else
+        {
+            return reader.fail("unknown keyword " + keyword);
+        }
+    }
+
+    if (!m_waves.empty() && m_waves.back().spawn_count == 0) return reader.fail("last wave has no spawns");
+
+    // Lines may interleave; stable, so spawns at the same time keep file order
+    for (const Wave &wave : m_waves)
+    {
+        std::stable_sort(m_spawns.begin() + wave.first_spawn, m_spawns.begin() + wave.first_spawn + wave.spawn_count,
+                         [](const WaveSpawn &a, const WaveSpawn &b) { return a.time < b.time; });
+    }
+    return true;
+}
+
+void WaveDirector::reset(GameState &state, const Entity &prototype)
+{
+    for (Entity &enemy : m_pool)
+    {
+        if (!enemy.get_is_active()) continue;
+        detach_enemy_ai(state, &enemy);
+        detach_enemy_animator(state, &enemy);
+    }
+
+    int capacity = 0;
+    for (const Wave &wave : m_waves) capacity = std::max(capacity, wave.spawn_count);
+
+    m_prototype = prototype;
+    m_pool.assign(capacity, prototype);
+    m_free_slots.clear();
+
+    // Handed out from the back, so the first spawns take the first slots
+    for (int slot = capacity - 1; slot >= 0; slot--)
+    {
+        m_pool[slot].deactivate();
+        m_pool[slot].set_position(PARKED_POSITION);
+        m_free_slots.push_back(slot);
+    }
+
+    m_alive_count   = 0;
+    m_wave          = -1;
+    m_next_spawn    = 0;
+    m_wave_time     = 0.0f;
+    m_between_waves = true;
+    m_throttled_count = 0;
+
+    state.enemies     = m_pool.data();
+    state.enemy_count = capacity;
+}
+
+void WaveDirector::set_step_ms(float step_ms)
+{
+    m_step_ms = step_ms;
+    if (m_alive_count == 0) return;
+
+    // Everything the step does put down to the enemies, so it errs on the side of waiting
+    float enemy_ms = step_ms / m_alive_count;
+    m_enemy_ms = m_enemy_ms == 0.0f ? enemy_ms : glm::mix(m_enemy_ms, enemy_ms, WAVE_COST_SMOOTHING);
+}
+
+// How many more enemies this step can take before it goes over the budget
+int const WaveDirector::spawn_allowance() const
+{
+    float spawn_cost = m_enemy_ms + m_spawn_ms;
+    if (m_budget_ms <= 0.0f || spawn_cost <= 0.0f) return WAVE_MAX_SPAWNS_PER_STEP;
+
+    float headroom = m_budget_ms - m_step_ms;
+    if (headroom <= 0.0f) return 0;
+
+    return (int) std::min((float) WAVE_MAX_SPAWNS_PER_STEP, headroom / spawn_cost);
+}
+
+void WaveDirector::spawn(GameState &state, const WaveSpawn &entry)
+{
+    uint64_t start = profiler::now_ns();
+
+    int slot = m_free_slots.back();
+    m_free_slots.pop_back();
+
+    Entity &enemy = m_pool[slot];
+    enemy = m_prototype;
+    enemy.set_ai_type(entry.ai_type);
+    enemy.set_position(entry.position);
+    enemy.activate();
+    attach_enemy_ai(state, &enemy);
+    attach_enemy_animator(state, &enemy);
+    m_alive_count++;
+
+    float spawn_ms = (profiler::now_ns() - start) / 1e6f;
+    m_spawn_ms = m_spawn_ms == 0.0f ? spawn_ms : glm::mix(m_spawn_ms, spawn_ms, WAVE_COST_SMOOTHING);
+}
+
+void WaveDirector::update(GameState &state, float delta_time)
+{
+    PROFILE_ZONE("wave director");
+    m_throttled_count = 0;
+
+    if (m_between_waves)
+    {
+        // The next wave's delay only starts counting once the last is cleared
+        if (get_is_finished() || m_alive_count > 0) return;
+
+        m_wave_time += delta_time;
+        if (m_wave_time < m_waves[m_wave + 1].delay) return;
+
+        m_wave++;
+        m_next_spawn    = m_waves[m_wave].first_spawn;
+        m_wave_time     = 0.0f;
+        m_between_waves = false;
+    }
+    else
+    {
+        m_wave_time += delta_time;
+    }
+
+    const Wave &wave = m_waves[m_wave];
+    int wave_end = wave.first_spawn + wave.spawn_count;
+
+    // Sorted by time, so a search rather than walking a whole backed-up burst every step
+    auto due_end = std::upper_bound(m_spawns.begin() + m_next_spawn, m_spawns.begin() + wave_end, m_wave_time,
+                                    [](float time, const WaveSpawn &spawn) { return time < spawn.time; });
+    int due = (int) (due_end - (m_spawns.begin() + m_next_spawn));
+
+    int count = std::min({ due, spawn_allowance(), (int) m_free_slots.size() });
+    for (int i = 0; i < count; i++) spawn(state, m_spawns[m_next_spawn++]);
+    m_throttled_count = due - count;
+
+    if (m_next_spawn == wave_end)
+    {
+        m_between_waves = true;
+        m_wave_time     = 0.0f;
+    }
+}
+
+void WaveDirector::despawn(GameState &state, Entity* enemy)
+{
+    int slot = (int) (enemy - m_pool.data());
+    if (slot < 0 || slot >= get_capacity() || !enemy->get_is_active()) return;
+
+    detach_enemy_ai(state, enemy);
+    detach_enemy_animator(state, enemy);
+    enemy->deactivate();
+    enemy->set_position(PARKED_POSITION);
+
+    m_free_slots.push_back(slot);
+    m_alive_count--;
+}
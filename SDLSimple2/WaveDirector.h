@@ -0,0 +1,100 @@
+#pragma once
+#include <istream>
+#include <vector>
+#include "glm/glm.hpp"
+#include "Entity.h"
+
+class AssetPack;
+struct GameState;
+
+constexpr float WAVE_FRAME_BUDGET_MS     = 16.6f; // A step costing more than this makes a frame late at 60 Hz
+constexpr int   WAVE_MAX_SPAWNS_PER_STEP = 16;    // Whatever the budget allows, so the cost estimates catch up with a burst
+constexpr float WAVE_COST_SMOOTHING      = 0.1f;  // Weight of the newest measurement in the running averages
+
+// One enemy in a wave's spawn table
+struct WaveSpawn
+{
+    float     time;     // Seconds after the wave starts
+    AIType    ai_type;
+    glm::vec3 position;
+};
+
+struct Wave
+{
+    float delay;        // Seconds after the previous wave is cleared (or the level starts)
+    int   first_spawn;
+    int   spawn_count;
+};
+
+// Spawns the level's enemies in waves, read from a text file of spawn tables
+// (see assets/level1.waves). Each wave starts once the one before it has been
+// cleared, and its table is expanded and sorted by time at load, so spawning
+// only ever looks at the next entry.
+//
+// Enemies live in a pool sized at load for the biggest wave, which GameState
+// points its enemies at; free slots are inactive entities parked off the map,
+// as dead ones are. Spawning takes a slot and despawning hands it back, so
+// nothing is allocated while the game runs and entity pointers stay valid.
+//
+// The game reports what a step costs with set_step_ms. Spawns that would push
+// a step over the frame budget, going by what each enemy and each spawn has
+// cost so far, wait for a later step instead.
+class WaveDirector
+{
+private:
+    std::vector<WaveSpawn> m_spawns; // Grouped by wave, each wave's in time order
+    std::vector<Wave>      m_waves;
+
+    // ————— POOL ————— //
+    Entity              m_prototype;    // Every spawn starts as a copy of it
+    std::vector<Entity> m_pool;         // Never resized after reset(), so pointers into it stay valid
+    std::vector<int>    m_free_slots;
+    int                 m_alive_count = 0;
+
+    // ————— PROGRESS ————— //
+    int   m_wave       = -1;    // -1 before the first
+    int   m_next_spawn = 0;
+    float m_wave_time  = 0.0f;  // Since the wave started or, between waves, since the last was cleared
+    bool  m_between_waves = true;
+
+    // ————— BUDGET ————— //
+    float m_budget_ms = WAVE_FRAME_BUDGET_MS; // 0 never throttles
+    float m_step_ms   = 0.0f;
+    float m_enemy_ms  = 0.0f;  // What one enemy adds to a step, judging by the last measurements
+    float m_spawn_ms  = 0.0f;  // What spawning one takes
+    int   m_throttled_count = 0;
+
+    AssetPack* m_asset_pack = nullptr;
+
+    bool parse(std::istream &infile, const char* filepath);
+    int  const spawn_allowance() const;
+    void spawn(GameState &state, const WaveSpawn &entry);
+
+public:
+    // ————— METHODS ————— //
+    bool load(const char* filepath);
+
+    // Sizes the pool for the biggest wave, with every slot free, points state's
+    // enemies at it and goes back to before the first wave
+    void reset(GameState &state, const Entity &prototype);
+
+    // Starts waves and spawns whatever is due and fits in the budget. Call at
+    // the start of every step.
+    void update(GameState &state, float delta_time);
+
+    // Takes an enemy out of the game and frees its slot; anything else is ignored
+    void despawn(GameState &state, Entity* enemy);
+
+    // ————— GETTERS ————— //
+    int  const get_wave()            const { return m_wave; }
+    int  const get_wave_count()      const { return (int) m_waves.size(); }
+    int  const get_capacity()        const { return (int) m_pool.size(); }
+    int  const get_alive_count()     const { return m_alive_count; }
+    int  const get_throttled_count() const { return m_throttled_count; } // Due last update but held back by the budget
+    bool const get_is_finished()     const { return m_between_waves && m_wave == get_wave_count() - 1; } // Every wave spawned
+
+    // ————— SETTERS ————— //
+    void set_asset_pack(AssetPack* asset_pack) { m_asset_pack = asset_pack; }
+    void set_budget_ms(float budget_ms)        { m_budget_ms  = budget_ms;  }
+    void set_step_ms(float step_ms); // Measured by the game, e.g. a running average of its step cost
+};
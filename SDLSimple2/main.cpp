@@ -11,9 +11,8 @@
 #define STB_IMAGE_IMPLEMENTATION
 #define LOG(argument) std::cout << argument << '\n'
 #define GL_GLEXT_PROTOTYPES 1
-#define FIXED_TIMESTEP 0.0166666f
+#define FIXED_TIMESTEP 0.0166666f // 1/60; 1/30 also works now that rendering interpolates
 #define PLATFORM_COUNT 3
-#define ENEMY_COUNT 3
 
 #ifdef _WINDOWS
 #include <GL/glew.h>
@@ -29,21 +28,25 @@
 #include "cmath"
 #include <ctime>
 #include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include "Entity.h"
 #include "Map.h"
+#include "TextureLoader.h"
+#include "TextureAtlas.h"
+#include "AssetPack.h"
+#include "GLState.h"
+#include "Camera.h"
+#include "Profiler.h"
+#include "GpuProfiler.h"
+#include "GameState.h"
+#include "FrameStats.h"
+#include "RenderSnapshot.h"
+#include "TripleBuffer.h"
+#include "GameEvents.h"
 
 // ––––– STRUCTS AND ENUMS ––––– //
-struct GameState
-{
-    Entity *player;
-//    Entity *platforms;
-    Entity *enemies;
-    
-    Map* map;
-    
-    Mix_Music *bgm;
-    Mix_Chunk *jump_sfx;
-};
 // Map details
 constexpr int MAP_WIDTH = 14,
         MAP_HEIGHT = 5;
@@ -59,6 +62,13 @@ unsigned int LEVEL_DATA[] =
 
 enum AppStatus { RUNNING, TERMINATED };
 
+// Gathered by the main thread each frame, applied by the simulation thread at its next step
+struct PlayerInput
+{
+    float movement_x     = 0.0f;
+    bool  jump_requested = false; // Latched until a step consumes it
+};
+
 // ––––– CONSTANTS ––––– //
 constexpr int WINDOW_WIDTH  = 640,
           WINDOW_HEIGHT = 480;
@@ -78,14 +88,20 @@ constexpr char V_SHADER_PATH[] = "shaders/vertex_textured.glsl",
 
 constexpr float MILLISECONDS_IN_SECOND = 1000.0;
 
-constexpr char SPRITESHEET_FILEPATH[] = "assets/peach.png",
+constexpr char SPRITESHEET_FILEPATH[] = "assets/george_0.png", // Animated by the player set in entities.anim
                     MARIO_FILEPATH[] = "assets/mario4.png",
                     ENEMY_FILEPATH[] = "assets/goomba.png",
                     LUIGI_FILEPATH[] = "assets/luigi.png",
                     PLATFORM_FILEPATH[] = "assets/greenPipe.png",
                     THWOMP_FILEPATH[] = "assets/thwomp.png",
                     TILESHEET_FILEPATH[] = "assets/tiles.png",
-                    FONT_FILEPATH[] = "assets/font1.png";
+                    FONT_FILEPATH[] = "assets/font1.png",
+                    ATLAS_FILEPATH[] = "assets/atlas.txt", // Generated by tools/atlas_packer.cpp
+                    ASSET_PACK_FILEPATH[] = "assets/assets.pak", // Generated by tools/asset_packer.cpp
+                    BEHAVIOUR_TREES_FILEPATH[] = "assets/enemies.bt",
+                    UTILITY_AI_FILEPATH[] = "assets/enemies.ai",
+                    WAVES_FILEPATH[] = "assets/level1.waves",
+                    ANIMATION_FILEPATH[] = "assets/entities.anim";
         
 // Original soudn effects
 //constexpr char BGM_FILEPATH[] = "assets/crypto.mp3",
@@ -94,60 +110,90 @@ constexpr char SPRITESHEET_FILEPATH[] = "assets/peach.png",
 constexpr char BGM_FILEPATH[] = "assets/zenmusic.mp3",
            SFX_FILEPATH[] = "assets/jump2.wav";
 
-constexpr int NUMBER_OF_TEXTURES = 1;
-constexpr GLint LEVEL_OF_DETAIL  = 0;
-constexpr GLint TEXTURE_BORDER   = 0;
+constexpr int TEXTURE_UPLOADS_PER_FRAME = 2;
+
+constexpr char PROFILE_TRACE_FILEPATH[] = "profile_trace.json"; // Open in chrome://tracing
+constexpr char FRAME_STATS_FILEPATH[]   = "frame_stats.csv";
+constexpr float PROFILER_FONT_SIZE = 0.2f;
 
 constexpr float PLATFORM_OFFSET = 5.0f;
 
+// Substep budget. Never more than MAX_SUBSTEPS_PER_FRAME per frame, and fewer
+// when substeps get expensive enough to eat more than SUBSTEP_BUDGET_MS. Time
+// over the budget is dropped, so after a stall the game slows down briefly
+// instead of falling further and further behind.
+constexpr int   MAX_SUBSTEPS_PER_FRAME = 5;
+constexpr float SUBSTEP_BUDGET_MS      = 10.0f;
+constexpr float SUBSTEP_COST_SMOOTHING = 0.1f; // Weight of the newest substep in the running average
+
 // ––––– VARIABLES ––––– //
 GameState g_game_state;
 
 SDL_Window* g_display_window;
 
 ShaderProgram g_shader_program;
+TextureLoader* g_texture_loader;
+TextureAtlas* g_texture_atlas;
+AssetPack g_asset_pack;
+BehaviourTrees g_behaviour_trees;
+UtilityAi g_utility_ai;
+NavGraph g_nav_graph;
+WaveDirector g_wave_director;
+AnimationSystem g_animation;
+AtlasRegion g_font_region;
 glm::mat4 g_view_matrix, g_projection_matrix;
+Camera g_camera;
 
 float g_previous_ticks = 0.0f;
 float g_accumulator = 0.0f;
+float g_substep_ms = 0.0f; // Running average cost of one substep
+
+// The main thread polls input and renders; a second thread runs update(). They
+// only meet at the input (under its mutex) and the snapshot triple buffer.
+std::thread       g_simulation_thread;
+std::atomic<bool> g_simulation_running(false);
+std::mutex        g_input_mutex;
+PlayerInput       g_input;
+TripleBuffer<RenderSnapshot> g_snapshots;
+unsigned int g_built_map_revision = 0; // Render thread; the snapshot map revision the map's vertices were built from
 
 AppStatus g_app_status = RUNNING;
 
-GLuint load_texture(const char* filepath);
+bool g_show_profiler = false;
+bool g_capturing_trace = false;
+
+Mix_Chunk* load_sound(const char* filepath);
+Mix_Music* load_music(const char* filepath);
 
 void initialise();
 void process_input();
 void update();
 void render();
 void shutdown();
+void publish_snapshot(float ticks, float simulated_time);
+void simulation_loop();
 
 
 // ––––– GENERAL FUNCTIONS ––––– //
-GLuint load_texture(const char* filepath)
+Mix_Chunk* load_sound(const char* filepath)
 {
-    int width, height, number_of_components;
-    unsigned char* image = stbi_load(filepath, &width, &height, &number_of_components, STBI_rgb_alpha);
-    
-    if (image == NULL)
+    // The pack stays mapped until exit, so SDL_mixer can read from it directly
+    AssetView packed;
+    if (g_asset_pack.find(filepath, &packed))
     {
-        LOG("Unable to load image. Make sure the path is correct.");
-        assert(false);
+        return Mix_LoadWAV_RW(SDL_RWFromConstMem(packed.data, (int) packed.size), 1);
     }
-    
-    GLuint textureID;
-    glGenTextures(NUMBER_OF_TEXTURES, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, LEVEL_OF_DETAIL, GL_RGBA, width, height, TEXTURE_BORDER, GL_RGBA, GL_UNSIGNED_BYTE, image);
-    
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    
-    stbi_image_free(image);
-    
-    return textureID;
+    return Mix_LoadWAV(filepath);
+}
+
+Mix_Music* load_music(const char* filepath)
+{
+    AssetView packed;
+    if (g_asset_pack.find(filepath, &packed))
+    {
+        return Mix_LoadMUS_RW(SDL_RWFromConstMem(packed.data, (int) packed.size), 1);
+    }
+    return Mix_LoadMUS(filepath);
 }
 
 void initialise()
@@ -174,78 +220,104 @@ void initialise()
     // ––––– VIDEO STUFF ––––– //
     glViewport(VIEWPORT_X, VIEWPORT_Y, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
 
+    // One mapped archive instead of a file open per asset; loose files are the fallback
+    if (!g_asset_pack.open(ASSET_PACK_FILEPATH))
+    {
+        LOG("No asset pack found, loading loose assets");
+    }
+
+    g_shader_program.set_asset_pack(&g_asset_pack);
     g_shader_program.load(V_SHADER_PATH, F_SHADER_PATH);
     
     g_view_matrix = glm::mat4(1.0f);
 
     g_projection_matrix = glm::ortho(-5.0f, 5.0f, -3.75f, 3.75f, -1.0f, 1.0f);
 
-    g_shader_program.set_projection_matrix(g_projection_matrix);
-    g_shader_program.set_view_matrix(g_view_matrix);
+    // View and projection are uploaded once per frame and shared by every program
+    g_camera.initialise();
+    gpu_profiler::initialise();
+    g_camera.set_projection_matrix(g_projection_matrix);
+    g_camera.set_view_matrix(g_view_matrix);
+    g_camera.set_viewport(VIEWPORT_X, VIEWPORT_Y, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
 
-    glUseProgram(g_shader_program.get_program_id());
+    gl_state::use_program(g_shader_program.get_program_id());
 
     glm::vec3 acceleration = glm::vec3(0.0f,-4.905f, 0.0f); // Shared acceleration
 
     glClearColor(0.68f, 0.85f, 0.90f, 1.0f); // Pastel blue background color
     
+    // Textures decode in the background and show a placeholder until uploaded
+    g_texture_loader = new TextureLoader(std::thread::hardware_concurrency(), TEXTURE_UPLOADS_PER_FRAME);
+    g_texture_loader->set_asset_pack(&g_asset_pack);
+    
+    // Sprites share a few atlas pages so they can be drawn without rebinding
+    g_texture_atlas = new TextureAtlas(g_texture_loader);
+    g_texture_atlas->load(ATLAS_FILEPATH);
+    
     //PEACH//
-    GLuint player_texture_id = load_texture(SPRITESHEET_FILEPATH);
+    AtlasRegion player_region = g_texture_atlas->get_region(SPRITESHEET_FILEPATH);
     //Create player entity
 
-    g_game_state.player = new Entity(player_texture_id, 5.0f, 0.2f, 1.3f, PLAYER); // sprite hitbox (center of pos)
-    g_game_state.player->set_sprite_size(glm::vec3(2.0f, 4.0f, 0.0f)); // change size of sprite
+    g_game_state.player = new Entity(player_region, 5.0f, 0.2f, 1.3f, PLAYER); // sprite hitbox (center of pos)
+    g_game_state.player->set_sprite_size(glm::vec3(1.5f, 1.5f, 0.0f)); // one frame of the sheet, not all of it
     g_game_state.player->set_position(glm::vec3(8.0f, 8.0f, 0.0f));
     g_game_state.player->set_acceleration(acceleration);
     g_game_state.player->set_jumping_power(7.0f);
     
+    // Clips are optional; anything without a set of them draws its whole region
+    g_animation.set_asset_pack(&g_asset_pack);
+    g_animation.load(ANIMATION_FILEPATH);
+    g_game_state.animation = &g_animation;
+    
+    int player_set = g_animation.find_set("player");
+    if (player_set >= 0) g_game_state.player->set_animator(g_animation.add_animator(player_set));
+    
     // Map Set up //
-    GLuint map_texture_id = load_texture(TILESHEET_FILEPATH);
-    g_game_state.map = new Map(MAP_WIDTH, MAP_HEIGHT, LEVEL_DATA, map_texture_id, 1.0f, 8, 8); // 1.0f, 4, 1
+    AtlasRegion map_region = g_texture_atlas->get_region(TILESHEET_FILEPATH);
+    g_game_state.map = new Map(MAP_WIDTH, MAP_HEIGHT, LEVEL_DATA, map_region, 1.0f, 8, 8); // 1.0f, 4, 1
 
     // ––––– GOOMBA ––––– Render enemies //
-    GLuint enemy_texture_id = load_texture(ENEMY_FILEPATH);
+    AtlasRegion enemy_region = g_texture_atlas->get_region(ENEMY_FILEPATH);
 
-    g_game_state.enemies = new Entity[ENEMY_COUNT];
+    // Every spawn is a copy of this, given its AIType and position by the spawn tables
+    Entity enemy_prototype = Entity(enemy_region, 0.5f, 1.0f, 1.0f, ENEMY, WALKER, IDLE);
+    enemy_prototype.set_sprite_size(glm::vec3(1.0f, 1.0f, 0.0f));
+    enemy_prototype.set_acceleration(acceleration);
+    enemy_prototype.set_jumping_power(2.0f);
     
-    AIType ait;
-    for (int i = 0; i < ENEMY_COUNT; i++)
-    {
-        switch (i) {
-            case 0:
-                ait = GUARD;
-            case 1:
-                ait = WALKER;
-            case 2:
-                ait = JUMPER;
-           
-        }
-        g_game_state.enemies[i] = Entity(enemy_texture_id, 0.5f, 1.0f, 1.0f, ENEMY, (AIType) i, IDLE); // 0 walker 1 guard 2 jumper
-        if (i == 2) { // Jumper position
-            g_game_state.enemies[i].set_position(glm::vec3(7.0f, 1.0f, 0.0f));
-        } else {
-            g_game_state.enemies[i].set_position(glm::vec3(i + 2.0f, 1.0f, 0.0f));
-        }
-        
-        g_game_state.enemies[i].set_sprite_size(glm::vec3(1.0f, 1.0f, 0.0f));
-        g_game_state.enemies[i].set_acceleration(acceleration);
-        g_game_state.enemies[i].set_jumping_power(2.0f);
-    }
+    // Every enemy moves the same way, so they share one graph. Loaded from
+    // nav_cache/ unless the level or their physics changed since it was made.
+    g_nav_graph.build(g_game_state.map, nav_physics_of(enemy_prototype));
+    g_game_state.nav_graph = &g_nav_graph;
+    
+    // Each enemy takes its type's utility profile if there is one, else its
+    // tree, else keeps ai_activate (which is also what happens with neither file)
+    g_utility_ai.set_asset_pack(&g_asset_pack);
+    g_behaviour_trees.set_asset_pack(&g_asset_pack);
+    g_utility_ai.set_nav_graph(&g_nav_graph);
+    g_behaviour_trees.set_nav_graph(&g_nav_graph);
+    if (g_utility_ai.load(UTILITY_AI_FILEPATH))           g_game_state.utility_ai      = &g_utility_ai;
+    if (g_behaviour_trees.load(BEHAVIOUR_TREES_FILEPATH)) g_game_state.behaviour_trees = &g_behaviour_trees;
+    
+    // Enemies arrive in waves from here on, handed their AI and animator as they spawn
+    g_wave_director.set_asset_pack(&g_asset_pack);
+    g_wave_director.load(WAVES_FILEPATH);
+    g_wave_director.reset(g_game_state, enemy_prototype);
+    g_game_state.wave_director = &g_wave_director;
     // Fonts
-    GLuint file_texture_id = load_texture(FONT_FILEPATH);
+    g_font_region = g_texture_atlas->get_region(FONT_FILEPATH);
     // ––––– PLATFORM ––––– //
-    GLuint platform_texture_id = load_texture(PLATFORM_FILEPATH);
+    AtlasRegion platform_region = g_texture_atlas->get_region(PLATFORM_FILEPATH);
     // Render platform obstacles
 //    g_game_state.platforms = new Entity[PLATFORM_COUNT];
     
 //     Starting platform
 //    for (int i = 0; i < PLATFORM_COUNT; i++)
 //    {
-//        g_game_state.platforms[i] = Entity(platform_texture_id, 0.0f, 1.0f, 1.0f, PLATFORM);
+//        g_game_state.platforms[i] = Entity(platform_region, 0.0f, 1.0f, 1.0f, PLATFORM);
 //        g_game_state.platforms[i].set_position(glm::vec3(i + 4.0f, 0.7f, 0.0f));
 //        g_game_state.platforms[i].set_sprite_size(glm::vec3(1.0f, 1.0f, 0.0f));
 //        g_game_state.platforms[i].update(0.0f,
-//                                    g_game_state.player,
 //                                    g_game_state.platforms,
 //                                    PLATFORM_COUNT,
 //                                    g_game_state.map
@@ -255,20 +327,34 @@ void initialise()
     // ––––– AUDIO STUFF ––––– //
     Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 4096);
 
-    g_game_state.bgm = Mix_LoadMUS(BGM_FILEPATH);
+    g_game_state.bgm = load_music(BGM_FILEPATH);
     Mix_PlayMusic(g_game_state.bgm, -1);
     Mix_VolumeMusic(MIX_MAX_VOLUME / 4.0f);
 
-    g_game_state.jump_sfx = Mix_LoadWAV(SFX_FILEPATH);
+    g_game_state.jump_sfx = load_sound(SFX_FILEPATH);
+
+    // ––––– EVENTS ––––– //
+    subscribe_game_rules(g_game_state);
+    game_events::subscribe(EVENT_SOUND, [](const GameEvent &event)
+    {
+        if (event.sound == SOUND_JUMP) Mix_PlayChannel(-1, g_game_state.jump_sfx, 0);
+    });
 
     // ––––– GENERAL STUFF ––––– //
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    
+    // ––––– SIMULATION THREAD ––––– //
+    // The first frame draws the starting state, so there is always something to show
+    publish_snapshot(0.0f, 0.0f);
+    g_simulation_running = true;
+    g_simulation_thread  = std::thread(simulation_loop);
 }
 
 void process_input()
 {
-    g_game_state.player->set_movement(glm::vec3(0.0f));
+    PROFILE_ZONE("process_input");
+    bool jump_pressed = false;
  
  SDL_Event event;
  while (SDL_PollEvent(&event))
@@ -287,13 +373,27 @@ void process_input()
                      g_app_status = TERMINATED;
                      break;
                      
+                 case SDLK_p:
+                     // Toggle the profiler overlay
+                     g_show_profiler = !g_show_profiler;
+                     break;
+                     
+                 case SDLK_t:
+                     // First press starts a trace capture, second press saves it
+                     if (!g_capturing_trace) profiler::start_capture();
+                     else if (profiler::write_chrome_trace(PROFILE_TRACE_FILEPATH)) LOG("Saved " << PROFILE_TRACE_FILEPATH);
+                     g_capturing_trace = !g_capturing_trace;
+                     break;
+                     
+                 case SDLK_c:
+                     // Toggles recording a row of frame stats per frame
+                     if (frame_stats::is_writing_csv()) frame_stats::stop_csv();
+                     else if (frame_stats::start_csv(FRAME_STATS_FILEPATH)) LOG("Writing " << FRAME_STATS_FILEPATH);
+                     break;
+                     
                  case SDLK_SPACE:
-                     // Jump
-                     if (g_game_state.player->get_collided_bottom())
-                     {
-                         g_game_state.player->jump();
-                         Mix_PlayChannel(-1, g_game_state.jump_sfx, 0);
-                     }
+                     // Jump; whether the player can is up to the simulation
+                     jump_pressed = true;
                      break;
                      
                  default:
@@ -306,79 +406,130 @@ void process_input()
  }
  
  const Uint8 *key_state = SDL_GetKeyboardState(NULL);
+ float movement_x = 0.0f;
 
- if (key_state[SDL_SCANCODE_LEFT])       g_game_state.player->move_left();
- else if (key_state[SDL_SCANCODE_RIGHT]) g_game_state.player->move_right();
-     
- if (glm::length(g_game_state.player->get_movement()) > 1.0f)
-    g_game_state.player->normalise_movement();
- 
+ if (key_state[SDL_SCANCODE_LEFT])       movement_x = -1.0f;
+ else if (key_state[SDL_SCANCODE_RIGHT]) movement_x =  1.0f;
  
+ std::lock_guard<std::mutex> lock(g_input_mutex);
+ g_input.movement_x = movement_x;
+ if (jump_pressed) g_input.jump_requested = true;
+}
+
+// Runs on the simulation thread at the start of every step
+void apply_input()
+{
+    PlayerInput input;
+    {
+        std::lock_guard<std::mutex> lock(g_input_mutex);
+        input = g_input;
+        g_input.jump_requested = false;
+    }
+    
+    g_game_state.player->set_movement(glm::vec3(input.movement_x, 0.0f, 0.0f));
+    
+    if (input.jump_requested && g_game_state.player->get_collided_bottom()) g_game_state.player->jump();
 }
-bool lose_game = false;
 void update()
 {
+    PROFILE_ZONE("update");
     float ticks = (float)SDL_GetTicks() / MILLISECONDS_IN_SECOND;
     float delta_time = ticks - g_previous_ticks;
     g_previous_ticks = ticks;
 
     delta_time += g_accumulator;
 
-    if (delta_time < FIXED_TIMESTEP)
+    // Cap the catch-up, tighter still if the recent substeps have been slow
+    int max_substeps = MAX_SUBSTEPS_PER_FRAME;
+    if (g_substep_ms > 0.0f) max_substeps = glm::clamp((int) (SUBSTEP_BUDGET_MS / g_substep_ms), 1, MAX_SUBSTEPS_PER_FRAME);
+    
+    if (delta_time > max_substeps * FIXED_TIMESTEP)
     {
-        g_accumulator = delta_time;
-        return;
+        frame_stats::current().substeps_dropped += (int) (delta_time / FIXED_TIMESTEP) - max_substeps;
+        delta_time = max_substeps * FIXED_TIMESTEP;
     }
     
+    float simulated_time = 0.0f;
+    
     while (delta_time >= FIXED_TIMESTEP)
     {
+        uint64_t substep_start = profiler::now_ns();
+        apply_input();
+        step_game_state(g_game_state, FIXED_TIMESTEP);
         
-//        g_game_state.player->update(FIXED_TIMESTEP, g_game_state.player, g_game_state.platforms, PLATFORM_COUNT, g_game_state.map);
-        g_game_state.player->update(FIXED_TIMESTEP, g_game_state.player, g_game_state.enemies, ENEMY_COUNT, g_game_state.map);
-        
-        for (int i = 0; i < ENEMY_COUNT; i++) {
-
-                g_game_state.enemies[i].update(FIXED_TIMESTEP,
-                                               g_game_state.player,
-                                               g_game_state.player,
-                                               1,
-                                               g_game_state.map
-                                               );
-                
-            if (g_game_state.enemies[i].get_ai_type() == JUMPER) {
-                g_game_state.enemies[i].ai_jump();
-            }
-            
-            g_game_state.player->check_collision_x(g_game_state.enemies, ENEMY_COUNT);
-            g_game_state.player->check_collision_y(g_game_state.enemies, ENEMY_COUNT);
-            if ((g_game_state.player->get_collided_left() || g_game_state.player->get_collided_right() && g_game_state.player->get_collided_with() == &g_game_state.enemies[i])) {
-                LOG("Hit 2");
-                lose_game = true;
-            }
-            else if (g_game_state.player->get_collided_bottom() && g_game_state.player->get_collided_with() == &g_game_state.enemies[i]) {
-                LOG("Hit1");
-                g_game_state.enemies[i].deactivate();
-            }
-        }
+        float substep_ms = (profiler::now_ns() - substep_start) / 1e6f;
+        g_substep_ms = g_substep_ms == 0.0f ? substep_ms : glm::mix(g_substep_ms, substep_ms, SUBSTEP_COST_SMOOTHING);
+        g_wave_director.set_step_ms(g_substep_ms);
         
-
-        
-        delta_time -= FIXED_TIMESTEP;
+        delta_time     -= FIXED_TIMESTEP;
+        simulated_time += FIXED_TIMESTEP;
     }
 
     g_accumulator = delta_time;
     
-    // Camera follows player
-    g_view_matrix = glm::mat4(1.0f);
-    g_view_matrix = glm::translate(g_view_matrix, glm::vec3(-g_game_state.player->get_position().x, 0.0f, 0.0f));
+    if (simulated_time > 0.0f) publish_snapshot(ticks, simulated_time);
+}
+
+// Copies out everything render() needs, so it never reads the live game state.
+// Animation only shows in the snapshots, so it advances here, by however long
+// the steps since the last one simulated.
+void publish_snapshot(float ticks, float simulated_time)
+{
+    RenderSnapshot &snapshot = g_snapshots.write_slot();
+    const Entity &player = *g_game_state.player;
+    
+    snapshot.sprites.clear();
+    snapshot.sprites.push_back(player.get_sprite_instance());
+    snapshot.enemies_remaining = 0;
+    g_animation.set_state(player.get_animator(), animation_state_of(player.get_movement()));
+    
+    for (int i = 0; i < g_game_state.enemy_count; i++)
+    {
+        const Entity &enemy = g_game_state.enemies[i];
+        if (!enemy.get_is_active()) continue;
+        
+        snapshot.sprites.push_back(enemy.get_sprite_instance());
+        snapshot.enemies_remaining++;
+        g_animation.set_state(enemy.get_animator(), animation_state_of(enemy.get_movement()));
+    }
+    
+    g_animation.advance(simulated_time);
+    g_animation.write_frames(snapshot.sprites.data(), (int) snapshot.sprites.size());
+    
+    const Map &map = *g_game_state.map;
+    if (snapshot.map_revision != map.get_revision())
+    {
+        snapshot.map_tiles.assign(map.get_level_data(), map.get_level_data() + map.get_width() * map.get_height());
+        snapshot.map_revision = map.get_revision();
+    }
+    
+    snapshot.waves_finished  = g_wave_director.get_is_finished();
+    snapshot.lose_game       = g_game_state.lose_game;
+    snapshot.published_ticks = ticks;
+    snapshot.accumulator     = g_accumulator;
+    
+    g_snapshots.publish();
+}
+
+void simulation_loop()
+{
+    while (g_simulation_running)
+    {
+        update();
+        frame_stats::flush_thread();
+        
+        // Nothing to do until the next step is due
+        std::this_thread::sleep_for(std::chrono::duration<float>(FIXED_TIMESTEP - g_accumulator));
+    }
 }
 constexpr int FONTBANK_SIZE = 16;
-void draw_text(ShaderProgram* shader_program, GLuint font_texture_id, std::string text, float font_size, float spacing, glm::vec3 position)
+void draw_text(ShaderProgram* shader_program, const AtlasRegion &font_region, std::string text, float font_size, float spacing, glm::vec3 position)
 {
+    PROFILE_ZONE("draw_text");
     // Scale the size of the fontbank in the UV-plane
     // We will use this for spacing and positioning
-    float width = 1.0f / FONTBANK_SIZE;
-    float height = 1.0f / FONTBANK_SIZE;
+    float width = font_region.uv_scale.x / FONTBANK_SIZE;
+    float height = font_region.uv_scale.y / FONTBANK_SIZE;
     
     // Instead of having a single pair of arrays, we'll have a series of pairs—one for
     // each character. Don't forget to include <vector>!
@@ -393,8 +544,9 @@ void draw_text(ShaderProgram* shader_program, GLuint font_texture_id, std::strin
         float offset = (font_size + spacing) * i;
         
         // 2. Using the spritesheet index, we can calculate our U- and V-coordinates
-        float u_coordinate = (float)(spritesheet_index % FONTBANK_SIZE) / FONTBANK_SIZE;
-        float v_coordinate = (float)(spritesheet_index / FONTBANK_SIZE) / FONTBANK_SIZE;
+        //    (then shifted into wherever the fontbank was packed in the atlas)
+        float u_coordinate = font_region.u((float)(spritesheet_index % FONTBANK_SIZE) / FONTBANK_SIZE);
+        float v_coordinate = font_region.v((float)(spritesheet_index / FONTBANK_SIZE) / FONTBANK_SIZE);
         // 3. Inset the current pair in both vectors
         vertices.insert(vertices.end(), {
             offset + (-0.5f * font_size), 0.5f * font_size,
@@ -420,45 +572,102 @@ void draw_text(ShaderProgram* shader_program, GLuint font_texture_id, std::strin
     model_matrix = glm::translate(model_matrix, position);
     
     shader_program->set_model_matrix(model_matrix);
-    glUseProgram(shader_program->get_program_id());
+    gl_state::use_program(shader_program->get_program_id());
     glVertexAttribPointer(shader_program->get_position_attribute(), 2, GL_FLOAT, false, 0,
                           vertices.data());
-    glEnableVertexAttribArray(shader_program->get_position_attribute());
+    gl_state::enable_vertex_attribute(shader_program->get_position_attribute());
     
     glVertexAttribPointer(shader_program->get_tex_coordinate_attribute(), 2, GL_FLOAT,
                           false, 0, texture_coordinates.data());
-    glEnableVertexAttribArray(shader_program->get_tex_coordinate_attribute());
-    
-    glBindTexture(GL_TEXTURE_2D, font_texture_id);
-    glDrawArrays(GL_TRIANGLES, 0, (int)(text.size() * 6));
+    gl_state::enable_vertex_attribute(shader_program->get_tex_coordinate_attribute());
     
-    glDisableVertexAttribArray(shader_program->get_position_attribute());
-    glDisableVertexAttribArray(shader_program->get_tex_coordinate_attribute());
+    gl_state::bind_texture(font_region.texture_id);
+    gl_state::draw_arrays(GL_TRIANGLES, 0, (int)(text.size() * 6), CLIENT_VERTEX_BYTES);
+}
+
+void draw_profiler_overlay(float camera_x)
+{
+    // Pinned to the top-left of the screen; the camera only scrolls in x
+    float left = camera_x - 4.8f;
+    float top  = 3.5f;
+    char  line[96];
+
+    snprintf(line, sizeof(line), "frame %.2f ms%s", profiler::get_frame_ms(), g_capturing_trace ? " [tracing]" : "");
+    draw_text(&g_shader_program, g_font_region, line, PROFILER_FONT_SIZE, 0.0f, glm::vec3(left, top, 0.0f));
+
+    // Everything drawn so far this frame, i.e. the scene without the overlay itself
+    GLStateCounters counters = gl_state::get_frame_counters();
+    snprintf(line, sizeof(line), "draws %d verts %d upload %.1f KB", counters.draw_calls, counters.vertices,
+             counters.bytes_uploaded / 1024.0f);
+    draw_text(&g_shader_program, g_font_region, line, PROFILER_FONT_SIZE, 0.0f,
+              glm::vec3(left, top - PROFILER_FONT_SIZE, 0.0f));
+
+    const std::vector<ZoneSummary> &zones = profiler::get_frame_summary();
+    for (int i = 0; i < (int) zones.size(); i++)
+    {
+        snprintf(line, sizeof(line), "%*s%s x%u %.3f ms", zones[i].depth * 2, "", zones[i].name, zones[i].calls, zones[i].total_ms);
+        draw_text(&g_shader_program, g_font_region, line, PROFILER_FONT_SIZE, 0.0f,
+                  glm::vec3(left, top - (i + 2) * PROFILER_FONT_SIZE, 0.0f));
+    }
 }
 
 void render()
 {
-    GLuint file_texture_id = load_texture(FONT_FILEPATH);
+    PROFILE_ZONE("render");
+    gl_state::begin_frame();
+    gpu_profiler::begin_frame();
+    g_texture_loader->upload_pending();
     glClear(GL_COLOR_BUFFER_BIT);
 
-    g_game_state.player->render(&g_shader_program);
-    g_game_state.map->render(&g_shader_program);
-    // Camera follows player
-    g_shader_program.set_view_matrix(g_view_matrix);
-    int inactive_count = 0;
-    for (int i = 0; i < ENEMY_COUNT; i++) {
-        if (g_game_state.enemies[i].get_is_active()) {
-            g_game_state.enemies[i].render(&g_shader_program);
-        } else {
-            inactive_count++;
-            g_game_state.enemies[i].set_position(glm::vec3(-10.0f,-10.0f,0.0f));
-        }
+    // Draw the newest state the simulation has published, part-way towards its
+    // next step by however long it has been since
+    g_snapshots.fetch();
+    const RenderSnapshot &snapshot = g_snapshots.read_slot();
+    
+    // Tile edits reach the vertices through the snapshot's copy, never the live level data
+    if (snapshot.map_revision != g_built_map_revision)
+    {
+        g_game_state.map->build(snapshot.map_tiles.data());
+        g_built_map_revision = snapshot.map_revision;
+    }
+    
+    float ticks = (float) SDL_GetTicks() / MILLISECONDS_IN_SECOND;
+    float alpha = glm::clamp((snapshot.accumulator + ticks - snapshot.published_ticks) / FIXED_TIMESTEP, 0.0f, 1.0f);
+    const SpriteInstance &player = snapshot.sprites[0];
+    float camera_x = player.interpolated_position(alpha).x;
+
+    // Camera follows player, at the same in-between position the player is drawn at
+    g_view_matrix = glm::mat4(1.0f);
+    g_view_matrix = glm::translate(g_view_matrix, glm::vec3(-camera_x, 0.0f, 0.0f));
+    g_camera.set_view_matrix(g_view_matrix);
+    g_camera.upload(ticks);
+    g_shader_program.set_camera(g_camera);
+
+    // GPU passes are timed separately; zones with the same name add up in the summary
+    {
+        GPU_ZONE("GPU entities");
+        Entity::render_sprite(&g_shader_program, player, alpha);
     }
-    if (lose_game == true) {
-        draw_text(&g_shader_program, file_texture_id, "You lose!", 1.0f, 0.0001f, glm::vec3(1.0f, 1.0f, 0.0f));
+    {
+        GPU_ZONE("GPU map");
+        g_game_state.map->render(&g_shader_program);
     }
-    else if (inactive_count == ENEMY_COUNT) {
-        draw_text(&g_shader_program, file_texture_id, "You win!", 1.0f, 0.0001f, glm::vec3(1.0f, 1.0f, 0.0f));
+    {
+        GPU_ZONE("GPU entities");
+        for (int i = 1; i < (int) snapshot.sprites.size(); i++) {
+            Entity::render_sprite(&g_shader_program, snapshot.sprites[i], alpha);
+        }
+    }
+    {
+        GPU_ZONE("GPU text");
+        if (snapshot.lose_game == true) {
+            draw_text(&g_shader_program, g_font_region, "You lose!", 1.0f, 0.0001f, glm::vec3(1.0f, 1.0f, 0.0f));
+        }
+        else if (snapshot.waves_finished && snapshot.enemies_remaining == 0) {
+            draw_text(&g_shader_program, g_font_region, "You win!", 1.0f, 0.0001f, glm::vec3(1.0f, 1.0f, 0.0f));
+        }
+        
+        if (g_show_profiler) draw_profiler_overlay(camera_x);
     }
 
     SDL_GL_SwapWindow(g_display_window);
@@ -466,11 +675,19 @@ void render()
 
 void shutdown()
 {
+    // Everything below is shared with the simulation, so it has to stop first
+    g_simulation_running = false;
+    if (g_simulation_thread.joinable()) g_simulation_thread.join();
+    
+    frame_stats::stop_csv();
+    gpu_profiler::shutdown();
+    g_camera.shutdown();
     SDL_Quit();
 
 //    delete [] g_game_state.platforms;
-    delete [] g_game_state.enemies;
     delete    g_game_state.player;
+    delete    g_texture_atlas;
+    delete    g_texture_loader;
     Mix_FreeChunk(g_game_state.jump_sfx);
     Mix_FreeMusic(g_game_state.bgm);
 }
@@ -482,9 +699,12 @@ int main(int argc, char* argv[])
 
     while (g_app_status == RUNNING)
     {
+        profiler::begin_frame();
+        frame_stats::begin_frame();
         process_input();
-        update();
         render();
+        frame_stats::end_frame();
+        profiler::end_frame();
     }
 
     shutdown();
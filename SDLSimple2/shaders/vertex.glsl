@@ -1,11 +1,22 @@
 attribute vec4 position;
 
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
+
+// Shared per-frame camera; see Camera.h for the matching C++ struct
+#ifdef CAMERA_BLOCK
+layout(std140) uniform Camera
+{
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    mat4 viewProjectionMatrix;
+    vec4 viewport;
+    vec4 time;
+};
+#else
+uniform mat4 viewProjectionMatrix;
+#endif
 
 void main()
 {
-	vec4 p = viewMatrix * modelMatrix  * position;
-	gl_Position = projectionMatrix * p;
+	gl_Position = viewProjectionMatrix * (modelMatrix * position);
 }
@@ -2,14 +2,25 @@ attribute vec4 position;
 attribute vec2 texCoord;
 
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
+
+// Shared per-frame camera; see Camera.h for the matching C++ struct
+#ifdef CAMERA_BLOCK
+layout(std140) uniform Camera
+{
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    mat4 viewProjectionMatrix;
+    vec4 viewport;
+    vec4 time;
+};
+#else
+uniform mat4 viewProjectionMatrix;
+#endif
 
 varying vec2 texCoordVar;
 
 void main()
 {
-	vec4 p = viewMatrix * modelMatrix  * position;
     texCoordVar = texCoord;
-	gl_Position = projectionMatrix * p;
-}
\ No newline at end of file
+	gl_Position = viewProjectionMatrix * (modelMatrix * position);
+}
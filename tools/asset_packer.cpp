@@ -0,0 +1,133 @@
+/**
+* Offline asset pack builder.
+*
+* Bundles textures (decoded to raw RGBA ahead of time), shader sources, audio
+* and any other files into a single indexed archive that AssetPack mmaps at
+* runtime. Images are recognised by extension; everything else is stored as-is.
+*
+* Build and run from the SDLSimple2 folder so the entry names match the
+* relative paths used in main.cpp:
+*
+*   c++ -std=c++17 -O2 -o asset_packer ../tools/asset_packer.cpp
+*   ./asset_packer assets/assets.pak assets/atlas0.tga shaders/vertex_textured.glsl ...
+**/
+#define STB_IMAGE_IMPLEMENTATION
+#include "../SDLSimple2/stb_image.h"
+#include "../SDLSimple2/AssetPack.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct PackedFile
+{
+    asset_pack::Entry          entry;
+    std::vector<unsigned char> bytes;
+};
+
+bool ends_with(const std::string &text, const char* suffix)
+{
+    size_t length = std::strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+bool read_file(const char* filepath, std::vector<unsigned char> &bytes)
+{
+    FILE* file = std::fopen(filepath, "rb");
+    if (file == NULL) return false;
+
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+
+    bytes.resize(size);
+    bool ok = std::fread(bytes.data(), 1, size, file) == (size_t) size;
+    std::fclose(file);
+    return ok;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::printf("Usage: %s <output.pak> <file>...\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<PackedFile> files;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string name = argv[i];
+        if (name.size() >= asset_pack::NAME_LENGTH)
+        {
+            std::printf("Path %s is too long for the pack index\n", argv[i]);
+            return 1;
+        }
+
+        PackedFile file;
+        std::memset(&file.entry, 0, sizeof(file.entry));
+        std::strncpy(file.entry.name, argv[i], asset_pack::NAME_LENGTH - 1);
+
+        if (ends_with(name, ".png") || ends_with(name, ".tga") || ends_with(name, ".jpg"))
+        {
+            int width, height, number_of_components;
+            unsigned char* pixels = stbi_load(argv[i], &width, &height, &number_of_components, STBI_rgb_alpha);
+            if (pixels == NULL)
+            {
+                std::printf("Unable to load image %s\n", argv[i]);
+                return 1;
+            }
+
+            file.entry.kind   = asset_pack::TEXTURE_RGBA;
+            file.entry.width  = width;
+            file.entry.height = height;
+            file.bytes.assign(pixels, pixels + (size_t) width * height * 4);
+            stbi_image_free(pixels);
+        }
+        else if (!read_file(argv[i], file.bytes))
+        {
+            std::printf("Unable to read %s\n", argv[i]);
+            return 1;
+        }
+
+        file.entry.size = file.bytes.size();
+        files.push_back(std::move(file));
+    }
+
+    // Data follows the index, each entry padded out to the alignment
+    uint64_t offset = sizeof(asset_pack::Header) + files.size() * sizeof(asset_pack::Entry);
+    for (PackedFile &file : files)
+    {
+        offset = (offset + asset_pack::DATA_ALIGNMENT - 1) & ~(uint64_t)(asset_pack::DATA_ALIGNMENT - 1);
+        file.entry.offset = offset;
+        offset += file.entry.size;
+    }
+
+    FILE* output = std::fopen(argv[1], "wb");
+    if (output == NULL)
+    {
+        std::printf("Unable to write %s\n", argv[1]);
+        return 1;
+    }
+
+    asset_pack::Header header;
+    std::memcpy(header.magic, asset_pack::MAGIC, sizeof(header.magic));
+    header.entry_count = (uint32_t) files.size();
+    header.reserved    = 0;
+    std::fwrite(&header, sizeof(header), 1, output);
+
+    for (const PackedFile &file : files) std::fwrite(&file.entry, sizeof(file.entry), 1, output);
+
+    const unsigned char zeros[asset_pack::DATA_ALIGNMENT] = { 0 };
+    for (const PackedFile &file : files)
+    {
+        long position = std::ftell(output);
+        std::fwrite(zeros, 1, file.entry.offset - position, output);
+        std::fwrite(file.bytes.data(), 1, file.bytes.size(), output);
+    }
+
+    std::printf("Packed %d files into %s (%llu bytes)\n", (int) files.size(), argv[1], (unsigned long long) offset);
+    std::fclose(output);
+    return 0;
+}
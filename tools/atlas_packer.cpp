@@ -0,0 +1,231 @@
+/**
+* Offline texture atlas packer.
+*
+* Packs the given images into one or more square pages and writes them as
+* RLE-compressed TGA files (which stb_image reads back at runtime) plus a
+* plain-text manifest of sub-rects that TextureAtlas::load understands.
+*
+* Build and run from the SDLSimple2 folder so the region names match the
+* asset paths used in main.cpp:
+*
+*   g++ -std=c++17 -O2 -o atlas_packer ../tools/atlas_packer.cpp
+*   ./atlas_packer assets/atlas 2048 assets/peach.png assets/tiles.png ...
+**/
+#define STB_IMAGE_IMPLEMENTATION
+#include "../SDLSimple2/stb_image.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Transparent gutter around every sprite so GL_NEAREST never samples a neighbour
+constexpr int PADDING = 2;
+
+struct Image
+{
+    std::string    name;
+    int            width, height;
+    unsigned char* pixels;
+
+    // Filled in by the packer
+    int page = -1;
+    int x = 0, y = 0;
+};
+
+struct Page
+{
+    int size;
+    int shelf_y = PADDING, shelf_height = 0, cursor_x = PADDING;
+    std::vector<unsigned char> pixels;
+};
+
+// Shelf packing: images are placed left to right in rows, tallest first
+bool place(Page &page, Image &image)
+{
+    int padded_width  = image.width  + PADDING;
+    int padded_height = image.height + PADDING;
+
+    if (page.cursor_x + padded_width > page.size)
+    {
+        page.shelf_y     += page.shelf_height;
+        page.cursor_x     = PADDING;
+        page.shelf_height = 0;
+    }
+
+    if (page.cursor_x + padded_width > page.size || page.shelf_y + padded_height > page.size) return false;
+
+    image.x = page.cursor_x;
+    image.y = page.shelf_y;
+
+    page.cursor_x    += padded_width;
+    page.shelf_height = std::max(page.shelf_height, padded_height);
+    return true;
+}
+
+void blit(Page &page, const Image &image)
+{
+    for (int row = -1; row <= image.height; row++)
+    {
+        // Rows and columns just outside the sprite repeat its edge pixels
+        int source_row = std::min(std::max(row, 0), image.height - 1);
+
+        for (int col = -1; col <= image.width; col++)
+        {
+            int source_col = std::min(std::max(col, 0), image.width - 1);
+
+            const unsigned char* source = &image.pixels[(source_row * image.width + source_col) * 4];
+            unsigned char* target = &page.pixels[((image.y + row) * page.size + (image.x + col)) * 4];
+            std::memcpy(target, source, 4);
+        }
+    }
+}
+
+bool write_tga(const std::string &filepath, const Page &page)
+{
+    FILE* file = std::fopen(filepath.c_str(), "wb");
+    if (file == NULL) return false;
+
+    // Type 10 = run-length encoded true colour, descriptor 0x28 = 8 alpha bits, top-left origin
+    unsigned char header[18] = { 0 };
+    header[2]  = 10;
+    header[12] = page.size & 0xFF;
+    header[13] = (page.size >> 8) & 0xFF;
+    header[14] = page.size & 0xFF;
+    header[15] = (page.size >> 8) & 0xFF;
+    header[16] = 32;
+    header[17] = 0x28;
+    std::fwrite(header, 1, sizeof(header), file);
+
+    for (int row = 0; row < page.size; row++)
+    {
+        const unsigned char* line = &page.pixels[row * page.size * 4];
+        int col = 0;
+
+        while (col < page.size)
+        {
+            // Measure how long the current pixel repeats (packets cap at 128)
+            int run = 1;
+            while (col + run < page.size && run < 128 &&
+                   std::memcmp(&line[col * 4], &line[(col + run) * 4], 4) == 0) run++;
+
+            if (run > 1)
+            {
+                const unsigned char* p = &line[col * 4];
+                unsigned char packet[5] = { (unsigned char)(0x80 | (run - 1)), p[2], p[1], p[0], p[3] };
+                std::fwrite(packet, 1, sizeof(packet), file);
+                col += run;
+                continue;
+            }
+
+            // Otherwise gather literal pixels until the next run starts
+            int literal = 1;
+            while (col + literal < page.size && literal < 128 &&
+                   (col + literal + 1 >= page.size ||
+                    std::memcmp(&line[(col + literal) * 4], &line[(col + literal + 1) * 4], 4) != 0)) literal++;
+
+            unsigned char count = (unsigned char)(literal - 1);
+            std::fwrite(&count, 1, 1, file);
+            for (int i = 0; i < literal; i++)
+            {
+                const unsigned char* p = &line[(col + i) * 4];
+                unsigned char bgra[4] = { p[2], p[1], p[0], p[3] };
+                std::fwrite(bgra, 1, sizeof(bgra), file);
+            }
+            col += literal;
+        }
+    }
+
+    std::fclose(file);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 4)
+    {
+        std::printf("Usage: %s <output prefix> <page size> <image>...\n", argv[0]);
+        return 1;
+    }
+
+    std::string output_prefix = argv[1];
+    int page_size = std::atoi(argv[2]);
+
+    std::vector<Image> images;
+    for (int i = 3; i < argc; i++)
+    {
+        Image image;
+        int number_of_components;
+        image.name   = argv[i];
+        image.pixels = stbi_load(argv[i], &image.width, &image.height, &number_of_components, STBI_rgb_alpha);
+
+        if (image.pixels == NULL)
+        {
+            std::printf("Unable to load image %s\n", argv[i]);
+            return 1;
+        }
+        if (image.width + 2 * PADDING > page_size || image.height + 2 * PADDING > page_size)
+        {
+            std::printf("%s (%dx%d) does not fit on a %d page\n", argv[i], image.width, image.height, page_size);
+            return 1;
+        }
+        images.push_back(image);
+    }
+
+    std::vector<Image*> order;
+    for (Image &image : images) order.push_back(&image);
+    std::sort(order.begin(), order.end(), [](const Image* a, const Image* b) { return a->height > b->height; });
+
+    std::vector<Page> pages;
+    for (Image* image : order)
+    {
+        for (int i = 0; i < (int) pages.size() && image->page < 0; i++)
+        {
+            if (place(pages[i], *image)) image->page = i;
+        }
+
+        if (image->page < 0)
+        {
+            Page page;
+            page.size = page_size;
+            pages.push_back(page);
+            place(pages.back(), *image);
+            image->page = (int) pages.size() - 1;
+        }
+    }
+
+    for (Page &page : pages) page.pixels.assign(page.size * page.size * 4, 0);
+    for (Image &image : images) blit(pages[image.page], image);
+
+    std::string manifest_path = output_prefix + ".txt";
+    FILE* manifest = std::fopen(manifest_path.c_str(), "w");
+    if (manifest == NULL)
+    {
+        std::printf("Unable to write %s\n", manifest_path.c_str());
+        return 1;
+    }
+
+    std::fprintf(manifest, "# Generated by tools/atlas_packer.cpp, do not edit by hand\n");
+    for (int i = 0; i < (int) pages.size(); i++)
+    {
+        std::string page_path = output_prefix + std::to_string(i) + ".tga";
+        if (!write_tga(page_path, pages[i]))
+        {
+            std::printf("Unable to write %s\n", page_path.c_str());
+            return 1;
+        }
+        std::fprintf(manifest, "page %s %d %d\n", page_path.c_str(), pages[i].size, pages[i].size);
+    }
+    for (const Image &image : images)
+    {
+        std::fprintf(manifest, "region %s %d %d %d %d %d\n",
+                     image.name.c_str(), image.page, image.x, image.y, image.width, image.height);
+        stbi_image_free(image.pixels);
+    }
+    std::fclose(manifest);
+
+    std::printf("Packed %d images into %d page(s)\n", (int) images.size(), (int) pages.size());
+    return 0;
+}
@@ -0,0 +1,741 @@
+/**
+* Headless benchmarks for the simulation hot paths.
+*
+* Each benchmark runs at growing sizes (entities, map width or path length) and
+* reports the median time per iteration and per item: map queries and raycasts,
+* collision, perception, crowd separation, enemy AI, wave spawning, animation,
+* map building, pathfinding, the navigation graph and a whole fixed step.
+* Results are written as JSON so runs can be diffed. Nothing is drawn and no
+* window or GL context is opened; the GL library is only needed to link.
+*
+* Build and run through tools/run_benchmarks.sh, or by hand from the
+* SDLSimple2 folder:
+*
+*   c++ -std=gnu++20 -O2 -I. $(sdl2-config --cflags) -o ../tools/benchmark \
+*       ../tools/benchmark.cpp Entity.cpp Map.cpp GameState.cpp ... -lGL
+*   ../tools/benchmark results.json [name filter]
+**/
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "GameState.h"
+#include "Pathfinder.h"
+#include "NavGraph.h"
+#include "GameEvents.h"
+#include "Profiler.h"
+
+// Each sample runs the body enough times to take about this long (at least
+// once), and the reported figure is the median over SAMPLES samples
+constexpr double MIN_SAMPLE_NS = 50e6;
+constexpr int    SAMPLES       = 5;
+
+constexpr float FIXED_TIMESTEP = 0.0166666f;
+constexpr float TILE_SIZE      = 1.0f;
+constexpr int   TILE_COUNT_X   = 8,
+                TILE_COUNT_Y   = 8;
+
+const int ENTITY_COUNTS[] = { 10, 100, 1000, 10000, 100000 };
+const int TICK_ENEMY_COUNTS[] = { 3, 100, 1000, 10000 };
+
+struct BenchmarkResult
+{
+    std::string name;
+    long long   n;
+    long long   iterations;
+    double      ns_per_iteration;
+    double      ns_per_item;
+};
+
+// Written to after every iteration so the compiler cannot drop the work
+static volatile float g_sink;
+
+static std::vector<BenchmarkResult> g_results;
+static const char* g_filter = nullptr;
+
+static double now_ns()
+{
+    return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// items is how many units of work (queries, entities, tiles) one iteration does.
+// reset runs untimed before every sample so stateful bodies start from the same place.
+static void run_benchmark(const std::string &name, long long items,
+                          const std::function<void()> &body,
+                          const std::function<void()> &reset = nullptr)
+{
+    if (g_filter != nullptr && name.find(g_filter) == std::string::npos) return;
+
+    // Grow the batch until it is long enough to estimate the per-iteration cost
+    long long batch = 1;
+    double elapsed;
+    while (true)
+    {
+        if (reset) reset();
+        double start = now_ns();
+        for (long long i = 0; i < batch; i++) body();
+        elapsed = now_ns() - start;
+
+        if (elapsed >= MIN_SAMPLE_NS / 10.0) break;
+        batch *= 2;
+    }
+
+    long long per_sample = std::max(1LL, (long long) (MIN_SAMPLE_NS / (elapsed / batch)));
+    std::vector<double> samples;
+
+    for (int sample = 0; sample < SAMPLES; sample++)
+    {
+        if (reset) reset();
+        double start = now_ns();
+        for (long long i = 0; i < per_sample; i++) body();
+        samples.push_back((now_ns() - start) / (double) per_sample);
+    }
+
+    std::sort(samples.begin(), samples.end());
+    double median = samples[SAMPLES / 2];
+
+    g_results.push_back({ name, items, per_sample, median, median / (double) std::max(1LL, items) });
+    std::fprintf(stderr, "%-40s n=%-8lld %14.1f ns/iter %10.2f ns/item\n",
+                 name.c_str(), items, median, median / (double) std::max(1LL, items));
+}
+
+// A ground floor two tiles thick with scattered platforms above it
+static std::vector<unsigned int> make_level(int width, int height, unsigned int seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> tile(1, TILE_COUNT_X * TILE_COUNT_Y - 1);
+    std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+
+    std::vector<unsigned int> level(width * height, 0);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            bool wall     = x == 0 || x == width - 1;
+            bool ground   = y >= height - 2;
+            bool platform = y > 2 && y < height - 4 && chance(random) < 0.08f;
+            if (wall || ground || platform) level[y * width + x] = tile(random);
+        }
+    }
+    return level;
+}
+
+static void benchmark_is_solid()
+{
+    constexpr int WIDTH = 1024, HEIGHT = 64, QUERIES = 65536;
+
+    std::vector<unsigned int> level = make_level(WIDTH, HEIGHT, 1);
+    Map map(WIDTH, HEIGHT, level.data(), AtlasRegion(), TILE_SIZE, TILE_COUNT_X, TILE_COUNT_Y);
+
+    // Slightly wider than the map so the out-of-bounds early-outs are exercised too
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> x(map.get_left_bound() - 4.0f, map.get_right_bound() + 4.0f);
+    std::uniform_real_distribution<float> y(map.get_bottom_bound() - 4.0f, map.get_top_bound() + 4.0f);
+
+    std::vector<glm::vec3> probes(QUERIES);
+    for (glm::vec3 &probe : probes) probe = glm::vec3(x(random), y(random), 0.0f);
+
+    run_benchmark("Map::is_solid", QUERIES, [&]
+    {
+        float penetration_x, penetration_y, total = 0.0f;
+        for (const glm::vec3 &probe : probes)
+        {
+            if (map.is_solid(probe, &penetration_x, &penetration_y)) total += penetration_y;
+        }
+        g_sink = total;
+    });
+}
+
+// count enemies laid out in a row, with the mover overlapping a handful of them
+static std::vector<Entity> make_row(int count)
+{
+    std::vector<Entity> entities(count);
+    for (int i = 0; i < count; i++)
+    {
+        entities[i] = Entity(AtlasRegion(), 0.5f, 1.0f, 1.0f, ENEMY, (AIType) (i % 3), IDLE);
+        entities[i].set_position(glm::vec3(i * 1.5f, (i % 7) * 0.5f, 0.0f));
+        entities[i].set_sprite_size(glm::vec3(1.0f, 1.0f, 0.0f));
+    }
+    return entities;
+}
+
+static void benchmark_raycast()
+{
+    constexpr int WIDTH = 1024, HEIGHT = 64, RAYS = 4096;
+    constexpr float MAX_DISTANCE = 24.0f;
+
+    std::vector<unsigned int> level = make_level(WIDTH, HEIGHT, 6);
+    Map map(WIDTH, HEIGHT, level.data(), AtlasRegion(), TILE_SIZE, TILE_COUNT_X, TILE_COUNT_Y);
+
+    // Rays from random open spots in random directions, like a crowd of enemies looking around
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> x(1.0f, WIDTH - 2.0f);
+    std::uniform_real_distribution<float> y(-(HEIGHT - 3.0f), 0.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+
+    std::vector<Ray> rays(RAYS);
+    std::vector<glm::vec2> targets(RAYS);
+    for (int i = 0; i < RAYS; i++)
+    {
+        float a = angle(random);
+        rays[i] = { glm::vec2(x(random), y(random)), glm::vec2(cosf(a), sinf(a)), MAX_DISTANCE };
+        targets[i] = rays[i].origin + rays[i].direction * 8.0f;
+    }
+    std::vector<RayHit> hits(RAYS);
+
+    run_benchmark("Map::raycast", RAYS, [&]
+    {
+        map.raycast(rays.data(), RAYS, hits.data());
+        g_sink = hits[0].distance;
+    });
+
+    run_benchmark("Map::has_line_of_sight", RAYS, [&]
+    {
+        int visible = 0;
+        for (int i = 0; i < RAYS; i++) visible += map.has_line_of_sight(rays[i].origin, targets[i]);
+        g_sink = (float) visible;
+    });
+}
+
+static void benchmark_entity_collision()
+{
+    for (int count : ENTITY_COUNTS)
+    {
+        std::vector<Entity> enemies = make_row(count);
+        Entity mover(AtlasRegion(), 5.0f, 0.2f, 1.3f, PLAYER);
+
+        const glm::vec3 start = glm::vec3(count * 0.75f, 1.0f, 0.0f);
+
+        run_benchmark("Entity::check_collision_x", count, [&]
+        {
+            mover.set_position(start);
+            mover.set_velocity(glm::vec3(1.0f, 0.0f, 0.0f));
+            mover.check_collision_x(enemies.data(), count);
+            game_events::dispatch(); // Nobody listens; this just empties the queue
+            g_sink = mover.get_position().x;
+        });
+
+        run_benchmark("Entity::check_collision_y", count, [&]
+        {
+            mover.set_position(start);
+            mover.set_velocity(glm::vec3(0.0f, -1.0f, 0.0f));
+            mover.check_collision_y(enemies.data(), count);
+            game_events::dispatch();
+            g_sink = mover.get_position().y;
+        });
+    }
+}
+
+// Enemies in a row with one noise for every eight of them scattered along it,
+// so the number of stimuli grows with the number of agents. Stimuli are made
+// to last, so every iteration is one step's refresh on the same set. The map
+// is as long as the row, since the index only covers the map.
+static void benchmark_perception()
+{
+    std::mt19937 random(8);
+    Entity player(AtlasRegion(), 5.0f, 0.2f, 1.3f, PLAYER);
+
+    for (int count : ENTITY_COUNTS)
+    {
+        int width = std::max(1024, (int) (count * 1.5f) + 16);
+        std::vector<unsigned int> level = make_level(width, 16, 5);
+        Map map(width, 16, level.data(), AtlasRegion(), TILE_SIZE, TILE_COUNT_X, TILE_COUNT_Y);
+
+        std::vector<Entity> enemies = make_row(count);
+        std::uniform_real_distribution<float> x(0.0f, count * 1.5f);
+        player.set_position(glm::vec3(count * 0.75f, 1.0f, 0.0f));
+
+        Perception perception;
+        perception.add_stimulus({ STIMULUS_PLAYER, player.get_position(), PERCEPTION_RANGE, 1e9f, &player });
+        for (int i = 0; i < count / 8; i++)
+        {
+            perception.add_stimulus({ STIMULUS_NOISE, glm::vec3(x(random), 1.0f, 0.0f), NOISE_RADIUS, 1e9f });
+        }
+
+        unsigned int step = 0;
+        run_benchmark("Perception::update", count, [&]
+        {
+            perception.update(FIXED_TIMESTEP, enemies.data(), count, &map, step++);
+            g_sink = enemies[0].get_percept().distances[STIMULUS_PLAYER];
+        });
+    }
+}
+
+// Enemies packed four to a tile along the floor, so each overlaps several
+// neighbours, pushed apart from the same start every sample
+static void benchmark_crowd()
+{
+    constexpr int HEIGHT = 16;
+
+    for (int count : ENTITY_COUNTS)
+    {
+        int width = std::max(1024, count / 4 + 16);
+        std::vector<unsigned int> level = make_level(width, HEIGHT, 9);
+        Map map(width, HEIGHT, level.data(), AtlasRegion(), TILE_SIZE, TILE_COUNT_X, TILE_COUNT_Y);
+
+        std::vector<Entity> enemies(count);
+        for (int i = 0; i < count; i++)
+        {
+            enemies[i] = Entity(AtlasRegion(), 0.5f, 1.0f, 1.0f, ENEMY, (AIType) (i % 3), IDLE);
+            enemies[i].set_position(glm::vec3(8.0f + i * 0.25f, -(HEIGHT - 3) * TILE_SIZE, 0.0f));
+        }
+        const std::vector<Entity> initial_enemies = enemies;
+
+        Crowd crowd;
+        run_benchmark("Crowd::separate", count, [&]
+        {
+            crowd.separate(enemies.data(), count, &map);
+            g_sink = (float) crowd.get_pushed_count();
+        }, [&] { enemies = initial_enemies; });
+    }
+}
+
+// The same mix of enemy types driven by the built-in switch and by the trees in
+// assets/enemies.bt, then all of them on the guard profile from assets/enemies.ai,
+// all deciding on the same percepts; skipped if the trees cannot be found
+static void benchmark_ai()
+{
+    BehaviourTrees trees;
+    if (!trees.load("assets/enemies.bt")) return;
+
+    // Sight lines for the percepts are cast through this; the rows of enemies sit around its top edge
+    std::vector<unsigned int> level = make_level(1024, 64, 5);
+    Map map(1024, 64, level.data(), AtlasRegion(), TILE_SIZE, TILE_COUNT_X, TILE_COUNT_Y);
+
+    UtilityAi utility;
+    int profile = utility.load("assets/enemies.ai") ? utility.find_profile("guard") : -1;
+
+    const char* const tree_names[] = { "walker", "guard", "jumper" };
+    Entity player(AtlasRegion(), 5.0f, 0.2f, 1.3f, PLAYER);
+
+    for (int count : ENTITY_COUNTS)
+    {
+        std::vector<Entity> enemies = make_row(count);
+        player.set_position(glm::vec3(count * 0.75f, 1.0f, 0.0f));
+
+        // Enough steps for every enemy's percept to have been filled in once
+        Perception perception;
+        for (unsigned int step = 0; step < PERCEPTION_INTERVAL; step++)
+        {
+            perception.add_stimulus({ STIMULUS_PLAYER, player.get_position(), PERCEPTION_RANGE, 0.0f, &player });
+            perception.update(FIXED_TIMESTEP, enemies.data(), count, &map, step);
+        }
+
+        run_benchmark("Entity::ai_activate", count, [&]
+        {
+            for (Entity &enemy : enemies) enemy.ai_activate();
+            g_sink = enemies[0].get_movement().x;
+        });
+
+        trees.clear_agents();
+        for (Entity &enemy : enemies) trees.add_agent(trees.find_tree(tree_names[enemy.get_ai_type()]), &enemy);
+
+        run_benchmark("BehaviourTrees::tick", count, [&]
+        {
+            trees.tick(FIXED_TIMESTEP);
+            g_sink = enemies[0].get_movement().x;
+        });
+        trees.clear_agents();
+
+        // Every enemy on the one profile, so it is scored as a single batch
+        if (profile < 0) continue;
+        for (Entity &enemy : enemies) utility.add_agent(profile, &enemy);
+
+        run_benchmark("UtilityAi::tick", count, [&]
+        {
+            utility.tick();
+            g_sink = enemies[0].get_movement().x;
+        });
+        utility.clear_agents();
+    }
+}
+
+// A whole wave spawned out of the pool (at most WAVE_MAX_SPAWNS_PER_STEP per
+// update, with no frame budget) and every enemy despawned again, each handed
+// to and taken back from its behaviour tree. The spawn table is written to a
+// scratch file in the working folder and removed afterwards.
+static void benchmark_waves()
+{
+    constexpr char WAVES_FILEPATH[] = "benchmark.waves";
+    const int COUNTS[] = { 100, 1000, 10000 };
+
+    BehaviourTrees trees;
+    bool has_trees = trees.load("assets/enemies.bt");
+
+    std::vector<unsigned int> level = make_level(1024, 16, 10);
+    Map map(1024, 16, level.data(), AtlasRegion(), TILE_SIZE, TILE_COUNT_X, TILE_COUNT_Y);
+
+    Entity prototype(AtlasRegion(), 0.5f, 1.0f, 1.0f, ENEMY, WALKER, IDLE);
+    prototype.set_acceleration(glm::vec3(0.0f, -4.905f, 0.0f));
+
+    for (int count : COUNTS)
+    {
+        FILE* file = std::fopen(WAVES_FILEPATH, "w");
+        if (file == nullptr) return;
+        std::fprintf(file, "wave 0\n    spawn walker 8 -10 count=%d\n    spawn guard 16 -10 count=%d\n", count / 2, count - count / 2);
+        std::fclose(file);
+
+        GameState state;
+        state.map             = &map;
+        state.behaviour_trees = has_trees ? &trees : nullptr;
+
+        WaveDirector director;
+        director.set_budget_ms(0.0f);
+        bool loaded = director.load(WAVES_FILEPATH);
+        std::remove(WAVES_FILEPATH);
+        if (!loaded) return;
+
+        run_benchmark("WaveDirector spawn and despawn", count, [&]
+        {
+            director.reset(state, prototype);
+            while (director.get_alive_count() < count) director.update(state, FIXED_TIMESTEP);
+            for (int i = 0; i < state.enemy_count; i++) director.despawn(state, &state.enemies[i]);
+            g_sink = (float) director.get_capacity();
+        });
+    }
+}
+
+// Every animator walking or standing on the george clips in assets/entities.anim,
+// stepped and written into a sprite batch the way each snapshot does it;
+// skipped if the clips cannot be found
+static void benchmark_animation()
+{
+    AnimationSystem animation;
+    if (!animation.load("assets/entities.anim")) return;
+    int set = animation.find_set("george");
+    if (set < 0) return;
+
+    for (int count : ENTITY_COUNTS)
+    {
+        AnimationSystem animators = animation;
+        std::vector<SpriteInstance> sprites(count);
+
+        for (int i = 0; i < count; i++)
+        {
+            sprites[i].animator = animators.add_animator(set);
+            animators.set_state(sprites[i].animator, (AnimationState) (i % ANIMATION_STATE_COUNT));
+        }
+
+        run_benchmark("AnimationSystem advance and write", count, [&]
+        {
+            animators.advance(FIXED_TIMESTEP);
+            animators.write_frames(sprites.data(), count);
+            g_sink = (float) sprites[count - 1].animation_frame;
+        });
+    }
+}
+
+static void benchmark_map_build()
+{
+    const int SIZES[][2] = { { 256, 32 }, { 1024, 64 }, { 4096, 256 } };
+
+    for (const auto &size : SIZES)
+    {
+        std::vector<unsigned int> level = make_level(size[0], size[1], 3);
+        Map map(size[0], size[1], level.data(), AtlasRegion(), TILE_SIZE, TILE_COUNT_X, TILE_COUNT_Y);
+
+        run_benchmark("Map::build", (long long) size[0] * size[1], [&]
+        {
+            map.build(level.data());
+            g_sink = map.get_right_bound();
+        });
+    }
+}
+
+// Paths from near one end of ever longer levels to near the other, a few
+// pairs per level so one lucky straight line doesn't set the time. Also times
+// building the graph and patching it after a tile on a cluster's edge changes.
+static void benchmark_pathfinding()
+{
+    const int WIDTHS[] = { 1024, 8192, 32768 };
+    constexpr int HEIGHT = 64, QUERIES = 16;
+
+    for (int width : WIDTHS)
+    {
+        std::vector<unsigned int> level = make_level(width, HEIGHT, 9);
+        Map map(width, HEIGHT, level.data(), AtlasRegion(), TILE_SIZE, TILE_COUNT_X, TILE_COUNT_Y);
+
+        Pathfinder pathfinder;
+        run_benchmark("Pathfinder::build", (long long) width * HEIGHT, [&]
+        {
+            pathfinder.build(&map);
+            g_sink = (float) pathfinder.get_node_count();
+        });
+        pathfinder.build(&map);
+
+        std::mt19937 random(10);
+        std::uniform_int_distribution<int> offset(1, 64);
+        std::uniform_int_distribution<int> row(0, HEIGHT - 3);
+
+        std::vector<std::pair<glm::ivec2, glm::ivec2>> queries;
+        while ((int) queries.size() < QUERIES)
+        {
+            glm::ivec2 start = glm::ivec2(offset(random), row(random));
+            glm::ivec2 goal  = glm::ivec2(width - 1 - offset(random), row(random));
+            if (!map.is_solid_tile(start.x, start.y) && !map.is_solid_tile(goal.x, goal.y)) queries.push_back({ start, goal });
+        }
+
+        Path path;
+        run_benchmark("Pathfinder::find_path", QUERIES, [&]
+        {
+            for (const auto &query : queries) pathfinder.find_path(query.first, query.second, &path);
+            g_sink = (float) path.cost;
+        });
+
+        glm::ivec2 tile = glm::ivec2(width / 2 + PATH_CLUSTER_SIZE - 1, HEIGHT / 2);
+        std::vector<glm::ivec2> changed = { tile };
+
+        run_benchmark("Pathfinder::update_tiles", 1, [&]
+        {
+            map.set_tile(tile.x, tile.y, map.is_solid_tile(tile.x, tile.y) ? 0 : 1);
+            pathfinder.update_tiles(changed);
+            map.clear_changed_tiles();
+            g_sink = (float) pathfinder.get_node_count();
+        });
+    }
+}
+
+// Generating the navigation graph with the enemies' physics, loading it back
+// from the cache, steering a crowd towards one goal (the route is shared) and
+// towards a new goal every time (a fresh search each), and patching the graph
+// after a tile changes, in total and per step. build() leaves its cache in nav_cache/.
+static void benchmark_nav_graph()
+{
+    const int WIDTHS[] = { 1024, 8192 };
+    constexpr int HEIGHT = 64, CHASERS = 1000, GOALS = 8;
+
+    const NavPhysics physics = { 0.5f, 2.0f, -4.905f, 1.0f, 1.0f };
+
+    for (int width : WIDTHS)
+    {
+        std::vector<unsigned int> level = make_level(width, HEIGHT, 11);
+        Map map(width, HEIGHT, level.data(), AtlasRegion(), TILE_SIZE, TILE_COUNT_X, TILE_COUNT_Y);
+
+        NavGraph graph;
+        run_benchmark("NavGraph::generate", (long long) width * HEIGHT, [&]
+        {
+            graph.generate(&map, physics);
+            g_sink = (float) graph.get_edge_count();
+        });
+
+        graph.build(&map, physics);
+        run_benchmark("NavGraph::build (cached)", (long long) width * HEIGHT, [&]
+        {
+            graph.build(&map, physics);
+            g_sink = (float) graph.get_edge_count();
+        });
+
+        // Standing on random nodes near the middle of the level
+        std::mt19937 random(12);
+        const std::vector<glm::ivec2> &nodes = graph.get_nodes();
+        std::uniform_int_distribution<int> pick(0, (int) nodes.size() - 1);
+
+        std::vector<Entity> chasers;
+        while ((int) chasers.size() < CHASERS)
+        {
+            glm::ivec2 tile = nodes[pick(random)];
+            if (std::abs(tile.x - width / 2) > 64) continue;
+
+            Entity chaser(AtlasRegion(), physics.speed, physics.width, physics.height, ENEMY, GUARD, WALKING);
+            chaser.set_has_external_ai(true);
+            chaser.set_acceleration(glm::vec3(0.0f, physics.gravity, 0.0f));
+            chaser.set_jumping_power(physics.jumping_power);
+            chaser.set_position(glm::vec3(tile.x * TILE_SIZE, -tile.y * TILE_SIZE, 0.0f));
+            chaser.update(FIXED_TIMESTEP, nullptr, 0, &map);
+            chasers.push_back(chaser);
+        }
+        game_events::reset();
+
+        glm::vec3 goals[GOALS];
+        for (glm::vec3 &goal : goals)
+        {
+            glm::ivec2 tile = nodes[pick(random)];
+            while (std::abs(tile.x - width / 2) > 64) tile = nodes[pick(random)];
+            goal = glm::vec3(tile.x * TILE_SIZE, -tile.y * TILE_SIZE, 0.0f);
+        }
+
+        NavSteering steering;
+        run_benchmark("NavGraph::steer (shared goal)", CHASERS, [&]
+        {
+            for (const Entity &chaser : chasers) graph.steer(chaser, goals[0], &steering);
+            g_sink = steering.direction;
+        });
+
+        int next_goal = 0;
+        run_benchmark("NavGraph::steer (new goal)", 1, [&]
+        {
+            graph.steer(chasers[0], goals[next_goal], &steering);
+            next_goal = (next_goal + 1) % GOALS;
+            g_sink = steering.direction;
+        });
+
+        glm::ivec2 tile = glm::ivec2(width / 2, HEIGHT / 2);
+        std::vector<glm::ivec2> changed = { tile };
+
+        auto edit = [&]
+        {
+            map.set_tile(tile.x, tile.y, map.is_solid_tile(tile.x, tile.y) ? 0 : 1);
+            graph.update_tiles(changed);
+            map.clear_changed_tiles();
+        };
+
+        // Everything one edit costs, over however many steps that takes
+        run_benchmark("NavGraph::update_tiles (until done)", 1, [&]
+        {
+            edit();
+            while (!graph.get_is_up_to_date()) graph.update();
+            g_sink = (float) graph.get_edge_count();
+        });
+
+        // What one step pays while the level keeps being edited
+        run_benchmark("NavGraph::update (per step)", 1, [&]
+        {
+            if (graph.get_is_up_to_date()) edit();
+            graph.update();
+            g_sink = (float) graph.get_edge_count();
+        });
+    }
+}
+
+static void benchmark_update_tick()
+{
+    constexpr int WIDTH = 4096, HEIGHT = 32;
+
+    std::vector<unsigned int> level = make_level(WIDTH, HEIGHT, 4);
+    Map map(WIDTH, HEIGHT, level.data(), AtlasRegion(), TILE_SIZE, TILE_COUNT_X, TILE_COUNT_Y);
+
+    glm::vec3 acceleration = glm::vec3(0.0f, -4.905f, 0.0f);
+    float ground = -(HEIGHT - 3) * TILE_SIZE;
+
+    for (int count : TICK_ENEMY_COUNTS)
+    {
+        // Same setup as initialise(), with the enemies spread along the level
+        Entity player(AtlasRegion(), 5.0f, 0.2f, 1.3f, PLAYER);
+        player.set_sprite_size(glm::vec3(2.0f, 4.0f, 0.0f));
+        player.set_acceleration(acceleration);
+        player.set_jumping_power(7.0f);
+        player.set_position(glm::vec3(WIDTH / 2.0f, ground, 0.0f));
+
+        std::vector<Entity> enemies(count);
+        for (int i = 0; i < count; i++)
+        {
+            enemies[i] = Entity(AtlasRegion(), 0.5f, 1.0f, 1.0f, ENEMY, (AIType) (i % 3), IDLE);
+            enemies[i].set_position(glm::vec3(2.0f + (WIDTH - 4.0f) * i / count, ground, 0.0f));
+            enemies[i].set_sprite_size(glm::vec3(1.0f, 1.0f, 0.0f));
+            enemies[i].set_acceleration(acceleration);
+            enemies[i].set_jumping_power(2.0f);
+        }
+
+        const Entity initial_player = player;
+        const std::vector<Entity> initial_enemies = enemies;
+
+        GameState state;
+        state.player      = &player;
+        state.enemies     = enemies.data();
+        state.enemy_count = count;
+        state.map         = &map;
+        state.bgm         = nullptr;
+        state.jump_sfx    = nullptr;
+
+        // Just the rules; nothing is listening for sounds
+        game_events::reset();
+        subscribe_game_rules(state);
+
+        auto reset = [&]
+        {
+            player  = initial_player;
+            enemies = initial_enemies;
+            state.enemies   = enemies.data();
+            state.lose_game = false;
+            state.perception.clear();
+        };
+
+        // With the level-of-detail scheduler (as the game runs) and without it
+        state.update_lod = true;
+        run_benchmark("step_game_state", count, [&]
+        {
+            step_game_state(state, FIXED_TIMESTEP);
+            g_sink = player.get_position().x;
+        }, reset);
+
+        state.update_lod = false;
+        run_benchmark("step_game_state/full_rate", count, [&]
+        {
+            step_game_state(state, FIXED_TIMESTEP);
+            g_sink = player.get_position().x;
+        }, reset);
+    }
+}
+
+static void write_json(FILE* file)
+{
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    std::fprintf(file, "{\n  \"context\": {\n");
+    std::fprintf(file, "    \"date\": \"%s\",\n", date);
+    std::fprintf(file, "    \"samples\": %d,\n", SAMPLES);
+    std::fprintf(file, "    \"profiler_zones\": %s\n", ENABLE_PROFILER ? "true" : "false");
+    std::fprintf(file, "  },\n  \"benchmarks\": [\n");
+
+    for (size_t i = 0; i < g_results.size(); i++)
+    {
+        const BenchmarkResult &result = g_results[i];
+        std::fprintf(file, "    { \"name\": \"%s\", \"n\": %lld, \"iterations\": %lld, "
+                           "\"ns_per_iteration\": %.2f, \"ns_per_item\": %.3f }%s\n",
+                     result.name.c_str(), result.n, result.iterations,
+                     result.ns_per_iteration, result.ns_per_item,
+                     i + 1 < g_results.size() ? "," : "");
+    }
+    std::fprintf(file, "  ]\n}\n");
+}
+
+int main(int argc, char* argv[])
+{
+    const char* output_filepath = argc > 1 ? argv[1] : nullptr;
+    if (argc > 2) g_filter = argv[2];
+
+    // Anything the game code logs is not what is being measured
+    std::cout.setstate(std::ios::badbit);
+
+    benchmark_is_solid();
+    benchmark_raycast();
+    benchmark_entity_collision();
+    benchmark_perception();
+    benchmark_crowd();
+    benchmark_ai();
+    benchmark_waves();
+    benchmark_animation();
+    benchmark_map_build();
+    benchmark_pathfinding();
+    benchmark_nav_graph();
+    benchmark_update_tick();
+
+    std::cout.clear();
+
+    if (output_filepath == nullptr)
+    {
+        write_json(stdout);
+        return 0;
+    }
+
+    FILE* file = std::fopen(output_filepath, "w");
+    if (file == nullptr)
+    {
+        std::fprintf(stderr, "Unable to write %s\n", output_filepath);
+        return 1;
+    }
+    write_json(file);
+    std::fclose(file);
+    return 0;
+}
@@ -0,0 +1,17 @@
+#!/bin/sh
+# Rebuilds SDLSimple2/assets/assets.pak from the atlas pages, loose sprites,
+# shaders and audio. Run tools/pack_atlas.sh first if any sprite changed.
+set -e
+cd "$(dirname "$0")/../SDLSimple2"
+c++ -std=c++17 -O2 -o ../tools/asset_packer ../tools/asset_packer.cpp
+../tools/asset_packer assets/assets.pak \
+    assets/atlas.txt \
+    assets/atlas*.tga \
+    assets/*.bt \
+    assets/*.ai \
+    assets/*.waves \
+    assets/*.anim \
+    assets/*.png \
+    assets/*.wav \
+    $(ls assets/*.mp3 2>/dev/null) \
+    shaders/*.glsl
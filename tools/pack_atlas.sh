@@ -0,0 +1,15 @@
+#!/bin/sh
+# Rebuilds SDLSimple2/assets/atlas*.tga and atlas.txt from the loose sprites.
+# Re-run whenever one of the packed images changes.
+set -e
+cd "$(dirname "$0")/../SDLSimple2"
+c++ -std=c++17 -O2 -o ../tools/atlas_packer ../tools/atlas_packer.cpp
+../tools/atlas_packer assets/atlas 2048 \
+    assets/peach.png \
+    assets/thwomp.png \
+    assets/mario4.png \
+    assets/goomba.png \
+    assets/greenPipe.png \
+    assets/tiles.png \
+    assets/font1.png \
+    assets/george_0.png
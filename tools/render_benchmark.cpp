@@ -0,0 +1,348 @@
+/**
+* Offscreen rendering benchmark.
+*
+* Creates a surfaceless EGL context (no window, no display server; Mesa falls
+* back to its software rasteriser when there is no GPU), renders into a
+* framebuffer object through the real Map::render and Entity::render_sprite paths and
+* reports, per scene: frame time, draw calls, vertices submitted and bytes
+* uploaded per frame (from the gl_state frame counters). Results are written as
+* JSON in the same shape as tools/benchmark.cpp.
+*
+* Build and run through tools/run_render_benchmark.sh (Linux only), or by hand
+* from the SDLSimple2 folder so the shader paths resolve:
+*
+*   c++ -std=gnu++20 -O2 -I. $(sdl2-config --cflags) -o ../tools/render_benchmark \
+*       ../tools/render_benchmark.cpp Entity.cpp Map.cpp ShaderProgram.cpp ... -lEGL -lGL
+*   ../tools/render_benchmark results.json [name filter]
+**/
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Entity.h"
+#include "Map.h"
+#include "ShaderProgram.h"
+#include "Camera.h"
+#include "GLState.h"
+
+// Same framebuffer and camera as the game window
+constexpr int FRAMEBUFFER_WIDTH  = 640,
+              FRAMEBUFFER_HEIGHT = 480;
+
+constexpr char V_SHADER_PATH[] = "shaders/vertex_textured.glsl",
+               F_SHADER_PATH[] = "shaders/fragment_textured.glsl";
+
+// Frames are timed until either limit is reached, after WARMUP_FRAMES untimed ones
+constexpr int    WARMUP_FRAMES = 2;
+constexpr int    MIN_FRAMES    = 5;
+constexpr int    MAX_FRAMES    = 120;
+constexpr double MAX_SCENE_MS  = 2000.0;
+
+constexpr float TILE_SIZE    = 1.0f;
+constexpr int   TILE_COUNT_X = 8,
+                TILE_COUNT_Y = 8;
+constexpr int   TEXTURE_SIZE = 64;
+
+// Sprites are scattered over a level this wide while the camera sees ten units,
+// so most of them are off screen, as they would be in a real level
+constexpr float SPRITE_FIELD_WIDTH  = 1024.0f,
+                SPRITE_FIELD_HEIGHT = 7.0f;
+
+const int SPRITE_COUNTS[] = { 1000, 10000, 100000 };
+const int MAP_SIZES[][2]  = { { 256, 64 }, { 1024, 256 }, { 2048, 512 } };
+
+struct RenderResult
+{
+    std::string     name;
+    long long       n;
+    int             frames;
+    double          frame_ms;     // Median, including glFinish
+    GLStateCounters counters;     // From the last timed frame; identical every frame
+};
+
+static std::vector<RenderResult> g_results;
+static const char* g_filter = nullptr;
+
+static ShaderProgram g_shader_program;
+static Camera        g_camera;
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool create_context()
+{
+    // Prefer Mesa's surfaceless platform; it needs neither X11 nor a GPU
+    EGLDisplay display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display != nullptr)
+    {
+        display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+    {
+        std::fprintf(stderr, "Unable to initialise EGL\n");
+        return false;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        std::fprintf(stderr, "EGL has no desktop OpenGL\n");
+        return false;
+    }
+
+    // Surfaceless displays only offer pbuffer configs; the default asks for windows
+    const EGLint config_attributes[] =
+    {
+        EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint    config_count = 0;
+    if (!eglChooseConfig(display, config_attributes, &config, 1, &config_count) || config_count == 0)
+    {
+        std::fprintf(stderr, "No EGL config supports desktop OpenGL\n");
+        return false;
+    }
+
+    // The game relies on client-side vertex arrays, so it needs a compatibility profile
+    const EGLint context_attributes[] =
+    {
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    {
+        std::fprintf(stderr, "Unable to create a surfaceless OpenGL context\n");
+        return false;
+    }
+    return true;
+}
+
+static bool create_framebuffer()
+{
+    GLuint framebuffer, colour_buffer;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    glGenRenderbuffers(1, &colour_buffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colour_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, FRAMEBUFFER_WIDTH, FRAMEBUFFER_HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colour_buffer);
+
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+// Stand-in for the spritesheets; what matters is that sampling it costs the same
+static GLuint create_texture()
+{
+    std::vector<unsigned char> pixels(TEXTURE_SIZE * TEXTURE_SIZE * 4);
+    for (int y = 0; y < TEXTURE_SIZE; y++)
+    {
+        for (int x = 0; x < TEXTURE_SIZE; x++)
+        {
+            unsigned char* pixel = &pixels[(y * TEXTURE_SIZE + x) * 4];
+            unsigned char  shade = ((x / 8 + y / 8) % 2) ? 200 : 80;
+            pixel[0] = shade; pixel[1] = shade; pixel[2] = shade; pixel[3] = 255;
+        }
+    }
+
+    GLuint texture_id;
+    glGenTextures(1, &texture_id);
+    gl_state::bind_texture(texture_id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, TEXTURE_SIZE, TEXTURE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return texture_id;
+}
+
+// Renders frames of draw_scene until the limits above and records the result
+template <typename DrawScene>
+static void run_scene(const std::string &name, long long n, glm::vec3 camera_position, DrawScene draw_scene)
+{
+    if (g_filter != nullptr && name.find(g_filter) == std::string::npos) return;
+
+    glm::mat4 view_matrix = glm::translate(glm::mat4(1.0f), -camera_position);
+    std::vector<double> frame_times;
+    GLStateCounters counters;
+    double scene_start = now_ms();
+
+    for (int frame = 0; frame < WARMUP_FRAMES + MAX_FRAMES; frame++)
+    {
+        double start = now_ms();
+        gl_state::begin_frame();
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        g_camera.set_view_matrix(view_matrix);
+        g_camera.upload((float) frame);
+        g_shader_program.set_camera(g_camera);
+
+        draw_scene();
+
+        // Without a swap nothing forces the (possibly software) renderer to finish
+        glFinish();
+        double elapsed = now_ms() - start;
+
+        if (frame < WARMUP_FRAMES) continue;
+        frame_times.push_back(elapsed);
+        counters = gl_state::get_frame_counters();
+
+        if ((int) frame_times.size() >= MIN_FRAMES && now_ms() - scene_start >= MAX_SCENE_MS) break;
+    }
+
+    std::sort(frame_times.begin(), frame_times.end());
+    double median = frame_times[frame_times.size() / 2];
+
+    g_results.push_back({ name, n, (int) frame_times.size(), median, counters });
+    std::fprintf(stderr, "%-24s n=%-8lld %9.3f ms %8d draws %10d verts %10.1f KB\n",
+                 name.c_str(), n, median, counters.draw_calls, counters.vertices,
+                 counters.bytes_uploaded / 1024.0);
+}
+
+static void benchmark_sprites(GLuint texture_id)
+{
+    for (int count : SPRITE_COUNTS)
+    {
+        std::vector<SpriteInstance> sprites(count);
+
+        std::mt19937 random(count);
+        std::uniform_real_distribution<float> x(0.0f, SPRITE_FIELD_WIDTH);
+        std::uniform_real_distribution<float> y(-SPRITE_FIELD_HEIGHT / 2.0f, SPRITE_FIELD_HEIGHT / 2.0f);
+
+        for (int i = 0; i < count; i++)
+        {
+            SpriteInstance &sprite = sprites[i];
+            sprite.region            = AtlasRegion(texture_id);
+            sprite.position          = glm::vec3(x(random), y(random), 0.0f);
+            sprite.previous_position = sprite.position;
+            sprite.sprite_size       = glm::vec3(1.0f, 1.0f, 0.0f);
+
+            // Half go through the spritesheet path, half through the whole-texture path
+            if (i % 2 == 0)
+            {
+                sprite.animation_cols  = 4;
+                sprite.animation_rows  = 4;
+                sprite.animation_frame = i % 4;
+            }
+        }
+
+        run_scene("sprites", count, glm::vec3(SPRITE_FIELD_WIDTH / 2.0f, 0.0f, 0.0f), [&]
+        {
+            for (const SpriteInstance &sprite : sprites) Entity::render_sprite(&g_shader_program, sprite, 1.0f);
+        });
+    }
+}
+
+static void benchmark_maps(GLuint texture_id)
+{
+    for (const auto &size : MAP_SIZES)
+    {
+        int width = size[0], height = size[1];
+
+        std::mt19937 random(width);
+        std::uniform_int_distribution<int> tile(1, TILE_COUNT_X * TILE_COUNT_Y - 1);
+        std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+
+        std::vector<unsigned int> level(width * height, 0);
+        for (unsigned int &cell : level)
+        {
+            if (chance(random) < 0.3f) cell = tile(random);
+        }
+
+        Map map(width, height, level.data(), AtlasRegion(texture_id), TILE_SIZE, TILE_COUNT_X, TILE_COUNT_Y);
+
+        run_scene("map", (long long) width * height, glm::vec3(width / 2.0f, -height / 2.0f, 0.0f), [&]
+        {
+            map.render(&g_shader_program);
+        });
+    }
+}
+
+static void write_json(FILE* file)
+{
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    std::fprintf(file, "{\n  \"context\": {\n");
+    std::fprintf(file, "    \"date\": \"%s\",\n", date);
+    std::fprintf(file, "    \"renderer\": \"%s\",\n", (const char*) glGetString(GL_RENDERER));
+    std::fprintf(file, "    \"version\": \"%s\",\n", (const char*) glGetString(GL_VERSION));
+    std::fprintf(file, "    \"framebuffer\": \"%dx%d\"\n", FRAMEBUFFER_WIDTH, FRAMEBUFFER_HEIGHT);
+    std::fprintf(file, "  },\n  \"benchmarks\": [\n");
+
+    for (size_t i = 0; i < g_results.size(); i++)
+    {
+        const RenderResult &result = g_results[i];
+        std::fprintf(file, "    { \"name\": \"%s\", \"n\": %lld, \"frames\": %d, \"frame_ms\": %.3f, "
+                           "\"draw_calls\": %d, \"vertices\": %d, \"bytes_uploaded\": %zu, "
+                           "\"state_calls_issued\": %d, \"state_calls_elided\": %d }%s\n",
+                     result.name.c_str(), result.n, result.frames, result.frame_ms,
+                     result.counters.draw_calls, result.counters.vertices, result.counters.bytes_uploaded,
+                     result.counters.issued, result.counters.elided,
+                     i + 1 < g_results.size() ? "," : "");
+    }
+    std::fprintf(file, "  ]\n}\n");
+}
+
+int main(int argc, char* argv[])
+{
+    const char* output_filepath = argc > 1 ? argv[1] : nullptr;
+    if (argc > 2) g_filter = argv[2];
+
+    if (!create_context() || !create_framebuffer())
+    {
+        std::fprintf(stderr, "No offscreen GL available\n");
+        return 1;
+    }
+    std::fprintf(stderr, "Renderer: %s (%s)\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+
+    // Mirrors initialise() in main.cpp
+    glViewport(0, 0, FRAMEBUFFER_WIDTH, FRAMEBUFFER_HEIGHT);
+    g_shader_program.load(V_SHADER_PATH, F_SHADER_PATH);
+    g_camera.initialise();
+    g_camera.set_projection_matrix(glm::ortho(-5.0f, 5.0f, -3.75f, 3.75f, -1.0f, 1.0f));
+    g_camera.set_viewport(0, 0, FRAMEBUFFER_WIDTH, FRAMEBUFFER_HEIGHT);
+    gl_state::use_program(g_shader_program.get_program_id());
+
+    glClearColor(0.68f, 0.85f, 0.90f, 1.0f);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    GLuint texture_id = create_texture();
+
+    benchmark_sprites(texture_id);
+    benchmark_maps(texture_id);
+
+    g_camera.shutdown();
+
+    if (output_filepath == nullptr)
+    {
+        write_json(stdout);
+        return 0;
+    }
+
+    FILE* file = std::fopen(output_filepath, "w");
+    if (file == nullptr)
+    {
+        std::fprintf(stderr, "Unable to write %s\n", output_filepath);
+        return 1;
+    }
+    write_json(file);
+    std::fclose(file);
+    return 0;
+}
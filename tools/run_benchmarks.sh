@@ -0,0 +1,16 @@
+#!/bin/sh
+# Builds tools/benchmark against the game sources and writes the results to
+# benchmark_results.json (or the path given). Needs the SDL2 headers and a GL
+# library to link with; no window or context is opened.
+# Pass -DENABLE_PROFILER=0 in BENCHMARK_CXXFLAGS to time without profiler zones.
+set -e
+cd "$(dirname "$0")/../SDLSimple2"
+case "$(uname)" in
+    Darwin) GL_LIBS="-framework OpenGL" ;;
+    *)      GL_LIBS="-lGL" ;;
+esac
+c++ -std=gnu++20 -O2 -DNDEBUG $BENCHMARK_CXXFLAGS -I. $(sdl2-config --cflags) \
+    -o ../tools/benchmark ../tools/benchmark.cpp \
+    Entity.cpp Map.cpp GameState.cpp GameEvents.cpp Perception.cpp Crowd.cpp Pathfinder.cpp NavGraph.cpp BehaviourTrees.cpp UtilityAi.cpp WaveDirector.cpp AnimationSystem.cpp FrameStats.cpp ShaderProgram.cpp Camera.cpp AssetPack.cpp GLState.cpp Profiler.cpp \
+    $GL_LIBS -lpthread
+../tools/benchmark "${1:-../benchmark_results.json}" $2
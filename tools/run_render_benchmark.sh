@@ -0,0 +1,12 @@
+#!/bin/sh
+# Builds tools/render_benchmark and writes the results to
+# render_benchmark_results.json (or the path given). Linux only: it renders
+# offscreen through a surfaceless EGL context, so it works on machines without
+# a GPU or display (Mesa's llvmpipe). Needs the SDL2, EGL and GL headers.
+set -e
+cd "$(dirname "$0")/../SDLSimple2"
+c++ -std=gnu++20 -O2 -DNDEBUG $BENCHMARK_CXXFLAGS -I. $(sdl2-config --cflags) \
+    -o ../tools/render_benchmark ../tools/render_benchmark.cpp \
+    Entity.cpp Map.cpp GameEvents.cpp FrameStats.cpp ShaderProgram.cpp Camera.cpp AssetPack.cpp GLState.cpp Profiler.cpp \
+    -lEGL -lGL -lpthread
+../tools/render_benchmark "${1:-../render_benchmark_results.json}" $2